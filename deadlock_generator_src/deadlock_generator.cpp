@@ -1,7 +1,12 @@
 #include "deadlock_generator.h"
 #include "sokoban_solver.h"
 #include "string_join.h"
+#include "pattern_solver.h"
+#include "thread_pool.h"
 #include <set>
+#include <bitset>
+#include <future>
+#include <cassert>
 
 using namespace std;
 using namespace Sokoban;
@@ -24,9 +29,16 @@ void DeadlockGenerator::initialize(const string & level) {
 }
 
 bool DeadlockGenerator::check_solution(const string & level) {
+    // the pattern boards are usually small enough for the bitboard solver
+    thread_local PatternSolver pattern_solver;
+    if (pattern_solver.parse(level)) {
+        const auto solved = pattern_solver.solve();
+        if (solved.has_value()) { return solved.value(); }
+    }
+
     istringstream iss(level);
 
-    Sokoban::Solver solver;
+    thread_local Sokoban::Solver solver;
     if (!solver.read_level_data(iss)) {
         cout << "ERROR LEVEL FORMAT" << endl; throw;
     }
@@ -34,105 +46,179 @@ bool DeadlockGenerator::check_solution(const string & level) {
     return solver.solve();
 }
 
-std::vector<DeadlockInfo> DeadlockGenerator::generate() {
+uint64_t DeadlockGenerator::cell_mask(const vector<size_t> & indexes) const {
+    uint64_t mask = 0u;
+    for (const auto ind: indexes) {
+        const auto it = find(begin(_wall_all_indexes), end(_wall_all_indexes), ind);
+        mask |= uint64_t{ 1u } << distance(begin(_wall_all_indexes), it);
+    }
+    return mask;
+}
+
+// the boxes and the goals placed on the pattern cells, the tested cell is the last bit
+uint64_t DeadlockGenerator::key(const BoxLayout & layout, const Combination & ci) const {
+    return (layout.boxmask << 32) | cell_mask(ci.goals);
+}
+
+// A wall on a cell without a box or a goal can only make a level harder,
+// so a combination which is unsolvable with one wall less stays unsolvable.
+// The layers with less walls store all their unsolvable combinations,
+// checking the combinations with one wall removed is enough.
+bool DeadlockGenerator::dominated(size_t wallbits, uint64_t key) const {
+    for (size_t rest = wallbits; rest != 0u; rest &= rest - 1) {
+        const size_t subset = wallbits & ~(rest & (~rest + 1));
+        if (_unsolvable[subset].count(key) != 0u) { return true; }
+    }
+    return false;
+}
+
+std::vector<DeadlockInfo> DeadlockGenerator::generate(size_t thread_count) {
     const size_t bit_count = _wall_all_indexes.size();
+    const size_t wall_combination_count = size_t{ 1u } << bit_count;
+    assert(bit_count < 32u);
+
+    _result.clear();
+    _unsolvable.assign(wall_combination_count, {});
+    vector<vector<BoxLayout>> layouts(wall_combination_count);
+    ThreadPool pool(thread_count);
+
+    // the combinations of walls are processed by the number of walls,
+    // so every layer can reuse the results of the previous one
+    for (size_t wall_count = 0; wall_count <= bit_count; ++wall_count) {
+        vector<future<void>> done;
+        for (size_t wallbits = 0; wallbits < wall_combination_count; wallbits++) {
+            if (bitset<32>(wallbits).count() != wall_count) { continue; }
+
+            layouts[wallbits] = combine_boxes(wallbits);
+            for (auto & layout: layouts[wallbits]) {
+                done.push_back(pool.submit([this, &layout]{ solve_goals(layout); }));
+            }
+        }
+        for (auto & d: done) { d.get(); }
 
-    const string level_bkp = _level_pattern;
-    for (size_t wallbits = 0; wallbits < (1u << bit_count); wallbits++) {
-        _level_pattern = level_bkp;
-        _box_all_indexes.clear();
-        _goal_all_indexes.clear();
-        Combination ci;
-
-        for (unsigned i = 0; i < bit_count; ++i) {
-            if (wallbits & (1u << i)) {
-                ci.walls.push_back(_wall_all_indexes[i]);
-                _level_pattern[_wall_all_indexes[i]] = '#';
-            } else {
-                _level_pattern[_wall_all_indexes[i]] = ' ';
-                _box_all_indexes.push_back(_wall_all_indexes[i]);
-                _goal_all_indexes.push_back(_wall_all_indexes[i]);
-             }
+        for (size_t wallbits = 0; wallbits < wall_combination_count; wallbits++) {
+            if (bitset<32>(wallbits).count() != wall_count) { continue; }
+
+            for (const auto & layout: layouts[wallbits]) {
+                string level;
+                for (size_t goalbits = 0; goalbits < layout.unsolvable.size(); goalbits++) {
+                    if (!layout.unsolvable[goalbits]) { continue; }
+                    _unsolvable[wallbits].insert(key(layout, combine_goals(layout, goalbits, level)));
+                }
+            }
         }
-        _goal_all_indexes.push_back(_test_index);
+    }
 
-        combine_boxes(ci);
+    // the results are collected in the order of the sequential enumeration
+    for (const auto & wall_layouts: layouts) {
+        for (const auto & layout: wall_layouts) { collect_deadlocks(layout); }
     }
 
     return _result;
 }
 
-void DeadlockGenerator::combine_boxes(Combination & ci) {
-    const string level_bkp = _level_pattern;
-    for (size_t boxbits = 0; boxbits < (1u << _box_all_indexes.size()); boxbits++) {
-        _level_pattern = level_bkp;
-        ci.boxes.clear();
+vector<DeadlockGenerator::BoxLayout> DeadlockGenerator::combine_boxes(size_t wallbits) const {
+    const size_t bit_count = _wall_all_indexes.size();
+
+    string level = _level_pattern;
+    Combination ci;
+    vector<size_t> box_all_indexes;
+    vector<size_t> goal_all_indexes;
 
-        for (unsigned i = 0; i < _box_all_indexes.size(); ++i) {
+    for (unsigned i = 0; i < bit_count; ++i) {
+        if (wallbits & (1u << i)) {
+            ci.walls.push_back(_wall_all_indexes[i]);
+            level[_wall_all_indexes[i]] = '#';
+        } else {
+            level[_wall_all_indexes[i]] = ' ';
+            box_all_indexes.push_back(_wall_all_indexes[i]);
+            goal_all_indexes.push_back(_wall_all_indexes[i]);
+         }
+    }
+    goal_all_indexes.push_back(_test_index);
+
+    vector<BoxLayout> result;
+    for (size_t boxbits = 0; boxbits < (1u << box_all_indexes.size()); boxbits++) {
+        BoxLayout layout{ ci, level, goal_all_indexes, wallbits, 0u, {} };
+
+        for (unsigned i = 0; i < box_all_indexes.size(); ++i) {
             if (boxbits & (1u << i)) {
-                ci.boxes.push_back(_box_all_indexes[i]);
-                _level_pattern[_box_all_indexes[i]] = '$';
-            } else {
-                _level_pattern[_box_all_indexes[i]] = ' ';
+                layout.ci.boxes.push_back(box_all_indexes[i]);
+                layout.level[box_all_indexes[i]] = '$';
             }
         }
+        layout.boxmask = cell_mask(layout.ci.boxes);
 
-        combine_goals(ci);
+        result.push_back(move(layout));
     }
+    return result;
 }
 
-// iterates through combinations of goals
-void DeadlockGenerator::combine_goals(Combination & ci) {
-    bool no_solutions_at_all = true;
-    vector<pair<Combination, bool>> local_results;
+// places the goals of the combination and the extra goals or boxes
+// to make the number of goals and boxes equal
+DeadlockGenerator::Combination DeadlockGenerator::combine_goals(const BoxLayout & layout,
+                                        size_t goalbits, string & level) const {
+    Combination ci = layout.ci;
+    level = layout.level;
 
-    // if there are all possible goal indexes are goals - there is always solution
-    // so we do not need to check this combination ('goalbits' will not reach '11..11')
-    size_t goal_combination_count = (1u << (_goal_all_indexes.size())) - 1;
-    const string level_bkp = _level_pattern;
-    for (size_t goalbits = 0; goalbits < goal_combination_count; goalbits++) {
-        _level_pattern = level_bkp;
-        ci.goals.clear();
-        ci.extra_boxes.clear();
-        ci.extra_goals.clear();
-
-        for (unsigned i = 0; i < _goal_all_indexes.size(); ++i) {
-            if (goalbits & (1u << i)) {
-                ci.goals.push_back(_goal_all_indexes[i]);
-
-                if (_level_pattern[_goal_all_indexes[i]] == '$') {
-                    _level_pattern[_goal_all_indexes[i]] = '*';
-                } else {
-                    _level_pattern[_goal_all_indexes[i]] = '.';
-                }
+    for (unsigned i = 0; i < layout.goal_indexes.size(); ++i) {
+        if (goalbits & (1u << i)) {
+            ci.goals.push_back(layout.goal_indexes[i]);
+
+            if (level[layout.goal_indexes[i]] == '$') {
+                level[layout.goal_indexes[i]] = '*';
+            } else {
+                level[layout.goal_indexes[i]] = '.';
             }
         }
+    }
 
-        while (ci.goal_count() < ci.box_count() + 1) {
-            const size_t exgoali = _extra_goal_indexes[ci.extra_goals.size()];
+    while (ci.goal_count() < ci.box_count() + 1) {
+        const size_t exgoali = _extra_goal_indexes[ci.extra_goals.size()];
 
-            ci.extra_goals.push_back(exgoali);
-            _level_pattern[exgoali] = '.';
-        }
+        ci.extra_goals.push_back(exgoali);
+        level[exgoali] = '.';
+    }
 
-        while (ci.goal_count() > ci.box_count() + 1) {
-            const size_t exboxi = _extra_box_indexes[ci.extra_boxes.size()];
+    while (ci.goal_count() > ci.box_count() + 1) {
+        const size_t exboxi = _extra_box_indexes[ci.extra_boxes.size()];
 
-            ci.extra_boxes.push_back(exboxi);
-            _level_pattern[exboxi] = '$';
-        }
+        ci.extra_boxes.push_back(exboxi);
+        level[exboxi] = '$';
+    }
 
-        /* cout << _level_pattern; */
-        /* cout << "walls:" << setw(10) << string_join(ci.walls) << "  " */
-        /*      << "boxes:" << setw(10) << string_join(ci.boxes) << "  " */
-        /*      << "goals:" << setw(10) << string_join(ci.goals) << setw(5); */
+    return ci;
+}
 
-        /* if (check_solution(_level_pattern)) { cout << "YES"; } */
-        /* else { cout << "NO"; } */
-        /* cout << '\n' << endl; */
+// checks all combinations of goals for the layout
+void DeadlockGenerator::solve_goals(BoxLayout & layout) {
+    // if there are all possible goal indexes are goals - there is always solution
+    // so we do not need to check this combination ('goalbits' will not reach '11..11')
+    const size_t goal_combination_count = (1u << (layout.goal_indexes.size())) - 1;
+    layout.unsolvable.assign(goal_combination_count, false);
+
+    string level;
+    for (size_t goalbits = 0; goalbits < goal_combination_count; goalbits++) {
+        const auto ci = combine_goals(layout, goalbits, level);
+
+        if (dominated(layout.wallbits, key(layout, ci))) {
+            layout.unsolvable[goalbits] = true;
+            ++_pruned_count;
+        } else {
+            layout.unsolvable[goalbits] = !check_solution(level);
+            ++_solved_count;
+        }
+    }
+}
+
+void DeadlockGenerator::collect_deadlocks(const BoxLayout & layout) {
+    bool no_solutions_at_all = true;
+    vector<pair<Combination, bool>> local_results;
 
-        if (!check_solution(_level_pattern)) {
-            local_results.push_back({ ci, no_solutions_at_all });
+    string level;
+    for (size_t goalbits = 0; goalbits < layout.unsolvable.size(); goalbits++) {
+        if (layout.unsolvable[goalbits]) {
+            local_results.push_back({ combine_goals(layout, goalbits, level), no_solutions_at_all });
         } else {
             no_solutions_at_all = false;
         }
@@ -142,17 +228,17 @@ void DeadlockGenerator::combine_goals(Combination & ci) {
     if (!local_results.empty()) {
         if (no_solutions_at_all) {
             local_results.front().first.goals.clear();
-            insert_deadlock(local_results.front().first, true);
+            insert_deadlock(local_results.front().first, true, layout.goal_indexes);
         } else {
             for (const auto & [combination, ingore]: local_results) {
-                insert_deadlock(combination, false);
+                insert_deadlock(combination, false, layout.goal_indexes);
             }
         }
     }
-
 }
 
-void DeadlockGenerator::insert_deadlock(const Combination & ci, bool not_depends_on_goals) {
+void DeadlockGenerator::insert_deadlock(const Combination & ci, bool not_depends_on_goals,
+                                        const vector<size_t> & goal_indexes) {
     auto getc = [testi=_test_index, _width=_width](size_t ind) {
         return offset(testi, ind, _width);
     };
@@ -167,7 +253,7 @@ void DeadlockGenerator::insert_deadlock(const Combination & ci, bool not_depends
 
     if (not_depends_on_goals) {
         dli.goalsets.push_back({});
-        transform(begin(_goal_all_indexes), end(_goal_all_indexes),
+        transform(begin(goal_indexes), end(goal_indexes),
                   back_inserter(dli.goalsets.front()), getc);
     } else {
         dli.goalsets.push_back({});
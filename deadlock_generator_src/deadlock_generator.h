@@ -4,6 +4,9 @@
 #include "deadlock_info.h"
 #include <string>
 #include <vector>
+#include <unordered_set>
+#include <atomic>
+#include <cstdint>
 
 namespace Sokoban
 {
@@ -19,6 +22,16 @@ class DeadlockGenerator {
         size_t goal_count() const { return goals.size() + extra_goals.size(); }
     };
 
+    // one combination of walls and boxes with the results for all goal combinations
+    struct BoxLayout {
+        Combination ci;
+        std::string level;
+        std::vector<size_t> goal_indexes;
+        size_t wallbits;
+        std::uint64_t boxmask;          // boxes as bits of the pattern cells
+        std::vector<char> unsolvable;   // for every combination of goals
+    };
+
     std::string _level_pattern;
     std::vector<size_t> _extra_goal_indexes;
     std::vector<size_t> _extra_box_indexes;
@@ -26,21 +39,38 @@ class DeadlockGenerator {
     size_t _width;
 
     std::vector<size_t> _wall_all_indexes;
-    std::vector<size_t> _box_all_indexes;
-    std::vector<size_t> _goal_all_indexes;
     std::vector<DeadlockInfo> _result;
 
+    // unsolvable box/goal combinations (see key()) for every combination of walls
+    std::vector<std::unordered_set<std::uint64_t>> _unsolvable;
+    std::atomic<size_t> _solved_count{ 0u };
+    std::atomic<size_t> _pruned_count{ 0u };
+
     bool check_solution(const std::string & level);
-    void combine_boxes(Combination & ci);
-    void combine_goals(Combination & ci);
+    std::uint64_t cell_mask(const std::vector<size_t> & indexes) const;
+    std::uint64_t key(const BoxLayout & layout, const Combination & ci) const;
+    bool dominated(size_t wallbits, std::uint64_t key) const;
 
-    void insert_deadlock(const Combination & ci, bool not_depends_on_goals);
+    std::vector<BoxLayout> combine_boxes(size_t wallbits) const;
+    Combination combine_goals(const BoxLayout & layout, size_t goalbits, std::string & level) const;
+    void solve_goals(BoxLayout & layout);
+    void collect_deadlocks(const BoxLayout & layout);
+
+    void insert_deadlock(const Combination & ci, bool not_depends_on_goals,
+                         const std::vector<size_t> & goal_indexes);
 
 public:
     DeadlockGenerator() = default;
 
     void initialize(const std::string & level);
-    std::vector<Sokoban::DeadlockInfo> generate();
+
+    // Checks the combinations on <thread_count> threads (0 - in the calling thread),
+    // the result doesn't depend on the number of threads
+    std::vector<Sokoban::DeadlockInfo> generate(size_t thread_count = 0);
+
+    // the number of levels checked by the solver and derived from other results
+    size_t solved_count() const { return _solved_count; }
+    size_t pruned_count() const { return _pruned_count; }
 };
 
 }
@@ -1,7 +1,10 @@
 #include "deadlock_info.h"
 #include "deadlock_generator.h"
+#include "deadlock_database.h"
 
 #include <iostream>
+#include <string>
+#include <thread>
 
 using namespace Sokoban;
 using namespace std;
@@ -28,10 +31,22 @@ constexpr const char * file_footer = 1 + R"(
 };
 )";
 
-int main() {
+// without arguments prints the patterns as the source file,
+// with "--binary <file>" writes them in the binary database format
+int main(int argc, char * argv[]) {
     DeadlockGenerator dl;
     dl.initialize(level_pattern);
-    auto deadlocks = dl.generate();
+    auto deadlocks = dl.generate(thread::hardware_concurrency());
+    cerr << "levels solved: " << dl.solved_count()
+         << ", derived: " << dl.pruned_count() << endl;
+
+    if (argc == 3 && string(argv[1]) == "--binary") {
+        if (!DeadlockDatabase::write(argv[2], deadlocks)) {
+            cerr << "Can't write " << argv[2] << endl;
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
 
     cout << file_header;
     for (const auto & dli: deadlocks) {
@@ -0,0 +1,144 @@
+#include "pattern_solver.h"
+
+#include <algorithm>
+#include <cassert>
+
+using namespace std;
+using namespace Sokoban;
+
+namespace
+{
+using bitboard_t = PatternSolver::bitboard_t;
+
+constexpr bitboard_t column(size_t x) {
+    bitboard_t result = 0u;
+    for (size_t y = 0; y < PatternSolver::MAX_SIZE; ++y) {
+        result |= bitboard_t{ 1u } << (y * PatternSolver::MAX_SIZE + x);
+    }
+    return result;
+}
+
+constexpr bitboard_t FIRST_COLUMN = column(0);
+constexpr bitboard_t LAST_COLUMN  = column(PatternSolver::MAX_SIZE - 1);
+
+constexpr bitboard_t left(bitboard_t b)  { return (b >> 1) & ~LAST_COLUMN; }
+constexpr bitboard_t right(bitboard_t b) { return (b << 1) & ~FIRST_COLUMN; }
+constexpr bitboard_t up(bitboard_t b)    { return b >> PatternSolver::MAX_SIZE; }
+constexpr bitboard_t down(bitboard_t b)  { return b << PatternSolver::MAX_SIZE; }
+
+// the shift of a bitboard in every direction and in the opposite one
+using shift_t = bitboard_t (*)(bitboard_t);
+constexpr shift_t SHIFTS[]   = { left, right, up, down };
+constexpr shift_t OPPOSITE[] = { right, left, down, up };
+
+inline size_t lowest(bitboard_t b) { return static_cast<size_t>(__builtin_ctzll(b)); }
+}
+
+PatternSolver::PatternSolver() : _visited(CAPACITY, Slot{ 0u, 0u, 0u }) {
+}
+
+bool PatternSolver::parse(const string & level) {
+    _floor = _goals = _dead = 0u;
+    _start = { 0u, 0u };
+
+    size_t x = 0, y = 0;
+    bool has_player = false;
+    for (const char c: level) {
+        if (c == '\n') { ++y; x = 0; continue; }
+        if (x >= MAX_SIZE || y >= MAX_SIZE) { return false; }
+
+        const bitboard_t bit = bitboard_t{ 1u } << (y * MAX_SIZE + x++);
+        if (c == '#') { continue; }
+
+        _floor |= bit;
+        if (c == '.' || c == '*' || c == '+') { _goals |= bit; }
+        if (c == '$' || c == '*')             { _start.boxes |= bit; }
+        if (c == '@' || c == '+') {
+            _start.player = static_cast<uint8_t>(lowest(bit));
+            has_player = true;
+        }
+    }
+    if (!has_player) { return false; }
+
+    // a box in a corner which isn't a goal can never be moved to a goal
+    for (bitboard_t rest = _floor & ~_goals; rest != 0u; rest &= rest - 1) {
+        const bitboard_t bit = rest & (~rest + 1);
+        const bool blocked_x = (left(bit) & _floor) == 0u || (right(bit) & _floor) == 0u;
+        const bool blocked_y = (up(bit)   & _floor) == 0u || (down(bit)  & _floor) == 0u;
+        if (blocked_x && blocked_y) { _dead |= bit; }
+    }
+
+    _start.player = static_cast<uint8_t>(lowest(reachable(bitboard_t{ 1u } << _start.player,
+                                                          _start.boxes)));
+    return true;
+}
+
+PatternSolver::bitboard_t PatternSolver::reachable(bitboard_t player, bitboard_t boxes) const {
+    const bitboard_t free = _floor & ~boxes;
+    bitboard_t reach = player & free;
+
+    for (;;) {
+        const bitboard_t next = (reach | left(reach) | right(reach) | up(reach) | down(reach)) & free;
+        if (next == reach) { return reach; }
+        reach = next;
+    }
+}
+
+// returns true if the position wasn't visited before
+bool PatternSolver::visit(const Position & pos) {
+    size_t slot = static_cast<size_t>((pos.boxes ^ pos.player) * 0x9E3779B97F4A7C15ull >> 48)
+                & (CAPACITY - 1);
+
+    for (;; slot = (slot + 1) & (CAPACITY - 1)) {
+        auto & s = _visited[slot];
+        if (s.stamp != _epoch) {
+            s = { pos.boxes, _epoch, pos.player };
+            ++_visited_count;
+            return true;
+        }
+        if (s.boxes == pos.boxes && s.player == pos.player) { return false; }
+    }
+}
+
+optional<bool> PatternSolver::solve() {
+    // on overflow of the counter the old stamps become ambiguous
+    if (++_epoch == 0u) {
+        fill(begin(_visited), end(_visited), Slot{ 0u, 0u, 0u });
+        _epoch = 1u;
+    }
+    _visited_count = 0u;
+    _stack.clear();
+
+    visit(_start);
+    _stack.push_back(_start);
+
+    while (!_stack.empty()) {
+        const auto pos = _stack.back();
+        _stack.pop_back();
+
+        if ((pos.boxes & ~_goals) == 0u) { return true; }
+
+        const bitboard_t reach = reachable(bitboard_t{ 1u } << pos.player, pos.boxes);
+        const bitboard_t free  = _floor & ~pos.boxes & ~_dead;
+
+        for (size_t d = 0; d < size(SHIFTS); ++d) {
+            // the boxes with the player behind them and a free tile in front of them
+            const bitboard_t pushable = pos.boxes & SHIFTS[d](reach) & OPPOSITE[d](free);
+
+            for (bitboard_t rest = pushable; rest != 0u; rest &= rest - 1) {
+                const bitboard_t box = rest & (~rest + 1);
+                const bitboard_t boxes = (pos.boxes & ~box) | SHIFTS[d](box);
+                const bitboard_t player = reachable(box, boxes);
+
+                const Position next{ boxes, static_cast<uint8_t>(lowest(player)) };
+                if (!visit(next)) { continue; }
+                // the table keeps a quarter free for short probe sequences
+                if (_visited_count > CAPACITY / 4 * 3) { return nullopt; }
+
+                _stack.push_back(next);
+            }
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,61 @@
+// Exhaustive push search for the tiny boards of the deadlock generator.
+// A board up to 8x8 is a set of 64-bit bitboards, the reachable area of the
+// player is a flood fill by shifts and all possible pushes of one direction
+// are found by one expression. Positions are the box bitboard and the top-left
+// reachable tile of the player. The visited set is a fixed-size open
+// addressing table stamped by the number of the search, so it is allocated
+// once and never cleared. Paths aren't recorded: only solvability is needed.
+
+#ifndef PATTERN_SOLVER_H
+#define PATTERN_SOLVER_H
+
+#include <string>
+#include <vector>
+#include <optional>
+#include <cstdint>
+
+namespace Sokoban
+{
+class PatternSolver {
+public:
+    using bitboard_t = std::uint64_t;
+    static constexpr size_t MAX_SIZE = 8;
+    static constexpr size_t CAPACITY = size_t{ 1u } << 16;
+
+private:
+    struct Position {
+        bitboard_t boxes;
+        std::uint8_t player;
+    };
+
+    struct Slot {
+        bitboard_t boxes;
+        std::uint32_t stamp;
+        std::uint8_t player;
+    };
+
+    bitboard_t _floor = 0u;
+    bitboard_t _goals = 0u;
+    bitboard_t _dead  = 0u;    // the corners where a box can't be moved from
+    Position _start{ 0u, 0u };
+
+    std::vector<Slot> _visited;
+    std::vector<Position> _stack;
+    std::uint32_t _epoch = 0u;
+    size_t _visited_count = 0u;
+
+    bitboard_t reachable(bitboard_t player, bitboard_t boxes) const;
+    bool visit(const Position & pos);
+
+public:
+    PatternSolver();
+
+    // returns false if the level is too large for the bitboards
+    bool parse(const std::string & level);
+
+    // solvability of the parsed level, nullopt if the visited set overflows
+    std::optional<bool> solve();
+};
+}
+
+#endif
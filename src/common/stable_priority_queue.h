@@ -25,7 +25,17 @@ private:
     }
 
 public:
-    explicit StablePriorityQueue(size_t size) : _queues(size) { };
+    explicit StablePriorityQueue(size_t size = 0) : _queues(size) { };
+
+    void clear() {
+        for (auto & q: _queues) { q.clear(); }
+    }
+
+    // removes all elements and sets the new number of priorities
+    void reset(size_t size) {
+        clear();
+        _queues.resize(size);
+    }
 
     void push(const size_t priority, const T & data) {
         assert(priority <= _queues.size() - 1);
@@ -52,6 +62,17 @@ public:
     bool empty() const {
         return max_priority_index() == 0 && _queues[0].empty();
     }
+
+    size_t size() const {
+        size_t result = 0u;
+        for (const auto & q: _queues) { result += q.size(); }
+        return result;
+    }
+
+    size_t priority_count() const { return _queues.size(); }
+
+    // the elements of one priority in the order of their extraction
+    const queue_t & elements(const size_t priority) const { return _queues[priority]; }
 };
 
 #endif
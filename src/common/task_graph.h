@@ -0,0 +1,157 @@
+// A set of tasks with dependencies executed on a ThreadPool.
+// A task is submitted as soon as all tasks it depends on are completed;
+// the thread calling run() only dispatches tasks and never executes them
+// while the pool has threads, so tasks don't wait for each other inside the pool.
+// Every task belongs to a named stage, run() collects timings per stage.
+
+#ifndef TASK_GRAPH_H
+#define TASK_GRAPH_H
+
+#include "thread_pool.h"
+
+#include <vector>
+#include <string>
+#include <functional>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <algorithm>
+#include <cassert>
+
+class TaskGraph {
+public:
+    using task_id = size_t;
+    using clock   = std::chrono::steady_clock;
+
+    struct StageTiming {
+        std::string name;
+        size_t task_count;
+        double elapsed_ms; // from the start of the first task to the end of the last one
+        double busy_ms;    // sum of the durations of all tasks
+    };
+
+private:
+    struct Task {
+        std::string stage;
+        std::function<void()> fn;
+        std::vector<task_id> dependents;
+        size_t waiting_for = 0u;
+        bool failed  = false;   // the task threw
+        bool skipped = false;   // a task it depends on failed or was skipped
+        clock::time_point started, finished;
+    };
+
+    std::vector<Task> _tasks;
+    std::vector<StageTiming> _timings;
+
+public:
+    // Adds a task which can start after all <dependencies> are completed
+    task_id add(std::string stage, std::function<void()> fn,
+                const std::vector<task_id> & dependencies = {}) {
+        const task_id id = _tasks.size();
+        _tasks.push_back({ std::move(stage), std::move(fn), {}, dependencies.size(), false, false, {}, {} });
+
+        for (const auto dep: dependencies) {
+            assert(dep < id);
+            _tasks[dep].dependents.push_back(id);
+        }
+        return id;
+    }
+
+    // Executes all tasks and waits for their completion. The tasks depending
+    // (directly or not) on a task which threw are skipped, they would work on
+    // incomplete data; the first exception is rethrown after the other tasks are done.
+    // The skipped tasks have no timings.
+    void run(ThreadPool & pool) {
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::vector<task_id> completed;
+        std::exception_ptr error;
+
+        auto submit = [&](task_id id) {
+            pool.submit([&, id]{
+                Task & task = _tasks[id];
+                task.started = clock::now();
+                try { task.fn(); }
+                catch (...) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    task.failed = true;
+                    if (!error) { error = std::current_exception(); }
+                }
+                task.finished = clock::now();
+
+                std::lock_guard<std::mutex> lock(mutex);
+                completed.push_back(id);
+                cv.notify_one();
+            });
+        };
+
+        for (task_id id = 0; id < _tasks.size(); ++id) {
+            if (_tasks[id].waiting_for == 0u) { submit(id); }
+        }
+
+        for (size_t done = 0u; done < _tasks.size(); ) {
+            std::vector<task_id> ready;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [&completed]{ return !completed.empty(); });
+                ready.swap(completed);
+            }
+
+            // a skipped task is completed at once, so its dependents are skipped as well
+            while (!ready.empty()) {
+                const task_id id = ready.back();
+                ready.pop_back();
+                done++;
+
+                const bool failed = _tasks[id].failed || _tasks[id].skipped;
+                for (const auto dep: _tasks[id].dependents) {
+                    Task & dependent = _tasks[dep];
+                    dependent.skipped = dependent.skipped || failed;
+                    if (--dependent.waiting_for != 0u) { continue; }
+
+                    if (dependent.skipped) { ready.push_back(dep); }
+                    else                   { submit(dep); }
+                }
+            }
+        }
+
+        collect_timings();
+        if (error) { std::rethrow_exception(error); }
+    }
+
+    // timings of the stages in the order of their first appearance
+    const std::vector<StageTiming> & timings() const { return _timings; }
+
+private:
+    void collect_timings() {
+        using ms = std::chrono::duration<double, std::milli>;
+        _timings.clear();
+
+        for (const auto & task: _tasks) {
+            if (task.skipped) { continue; }
+            auto it = std::find_if(std::begin(_timings), std::end(_timings),
+                                   [&task](const auto & st){ return st.name == task.stage; });
+            if (it == std::end(_timings)) {
+                _timings.push_back({ task.stage, 0u, 0., 0. });
+                it = std::prev(std::end(_timings));
+            }
+
+            it->task_count++;
+            it->busy_ms += ms(task.finished - task.started).count();
+        }
+
+        for (auto & st: _timings) {
+            clock::time_point first = clock::time_point::max(), last = clock::time_point::min();
+            for (const auto & task: _tasks) {
+                if (task.stage != st.name || task.skipped) { continue; }
+                first = std::min(first, task.started);
+                last  = std::max(last,  task.finished);
+            }
+            st.elapsed_ms = ms(last - first).count();
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,82 @@
+// A fixed-size pool of worker threads executing submitted tasks in FIFO order.
+// The pool without threads executes every task immediately in the thread
+// which submits it, so the single-threaded code path stays cheap.
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+
+class ThreadPool {
+    std::vector<std::thread> _workers;
+    std::deque<std::function<void()>> _tasks;
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    bool _stop = false;
+
+    void work() {
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _cv.wait(lock, [this]{ return _stop || !_tasks.empty(); });
+                if (_tasks.empty()) { return; }
+
+                task = std::move(_tasks.front());
+                _tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+public:
+    explicit ThreadPool(size_t thread_count = 0) {
+        _workers.reserve(thread_count);
+        for (size_t i = 0; i < thread_count; ++i) {
+            _workers.emplace_back([this]{ work(); });
+        }
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool & operator=(const ThreadPool &) = delete;
+
+    // waits for all submitted tasks to complete
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _cv.notify_all();
+        for (auto & w: _workers) { w.join(); }
+    }
+
+    size_t size() const noexcept { return _workers.size(); }
+
+    template <typename Fn>
+    auto submit(Fn && fn) -> std::future<decltype(fn())> {
+        using result_t = decltype(fn());
+        auto task = std::make_shared<std::packaged_task<result_t()>>(std::forward<Fn>(fn));
+        auto result = task->get_future();
+
+        if (_workers.empty()) {
+            (*task)();
+            return result;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _tasks.emplace_back([task]{ (*task)(); });
+        }
+        _cv.notify_one();
+        return result;
+    }
+};
+
+#endif
@@ -1,34 +1,45 @@
 // Zobrist hashing implementation.
 // SIZE      - is the number of random bitstrings,
 // HASH_TYPE - is a type that determines the length of a bitstring.
+// The bitstrings are generated by the splitmix64 generator from a seed,
+// so the tables are reproducible and may be built at compile time.
 
 #ifndef ZOBRIST_HASH_H
 #define ZOBRIST_HASH_H
 
 #include <array>
-#include <random>
 #include <cassert>
 #include <limits>
+#include <cstdint>
+
+constexpr std::uint64_t splitmix64(std::uint64_t & state) {
+    std::uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
 
 template <size_t SIZE, typename HASH_TYPE = unsigned long long>
 class ZobristHash {
+    static_assert(std::numeric_limits<HASH_TYPE>::digits <= 64,
+                  "the generator produces 64-bit values");
+
     std::array<HASH_TYPE, SIZE> _random_bits = { 0 };
-    static constexpr size_t BIT_COUNT = std::numeric_limits<HASH_TYPE>::digits;
+    std::uint64_t _seed;
 
 public:
-    ZobristHash() {
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        std::bernoulli_distribution distr(0.5);
-
-        for (auto & rb: _random_bits) {
-            for (size_t i = 0; i < BIT_COUNT; i++) {
-                rb |= static_cast<HASH_TYPE>(distr(gen)) << i;
-            }
+    static constexpr std::uint64_t DEFAULT_SEED = 0x5EED5EED5EED5EEDull;
+
+    constexpr explicit ZobristHash(std::uint64_t seed = DEFAULT_SEED) : _seed{ seed } {
+        std::uint64_t state = seed;
+        for (size_t i = 0; i < SIZE; ++i) {
+            _random_bits[i] = static_cast<HASH_TYPE>(splitmix64(state));
         }
     }
 
-    HASH_TYPE random_bits(size_t index) const {
+    constexpr std::uint64_t seed() const { return _seed; }
+
+    constexpr HASH_TYPE random_bits(size_t index) const {
         assert(index < _random_bits.size());
 
         return _random_bits[index];
@@ -0,0 +1,169 @@
+#include "deadlock_database.h"
+
+#include <fstream>
+#include <cstring>
+#include <cassert>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace Sokoban;
+using namespace std;
+
+constexpr char DeadlockDatabase::MAGIC[8];
+
+PointSpan DeadlockPatternView::walls() const {
+    return { _db->_points + _pattern->walls.offset, _pattern->walls.count };
+}
+
+PointSpan DeadlockPatternView::spaces() const {
+    return { _db->_points + _pattern->spaces.offset, _pattern->spaces.count };
+}
+
+PointSpan DeadlockPatternView::boxes() const {
+    return { _db->_points + _pattern->boxes.offset, _pattern->boxes.count };
+}
+
+PointSpan DeadlockPatternView::goalset(size_t index) const {
+    const PackedRange & gs = _db->_goalsets[_pattern->goalsets.offset + index];
+    return { _db->_points + gs.offset, gs.count };
+}
+
+DeadlockDatabase::~DeadlockDatabase() {
+    if (_mapped != nullptr) { munmap(_mapped, _size); }
+}
+
+// checks the structure of the data without reading the patterns into objects
+bool DeadlockDatabase::attach(const unsigned char * data, size_t size) {
+    if (size < sizeof(Header)) { return false; }
+
+    const auto * header = reinterpret_cast<const Header *>(data);
+    if (memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0) { return false; }
+    if (header->version != VERSION) { return false; }
+
+    const size_t expected = sizeof(Header)
+                          + header->pattern_count * sizeof(PackedPattern)
+                          + header->goalset_count * sizeof(PackedRange)
+                          + header->point_count   * sizeof(PackedPoint);
+    if (size != expected) { return false; }
+
+    _data     = data;
+    _size     = size;
+    _header   = header;
+    _patterns = reinterpret_cast<const PackedPattern *>(data + sizeof(Header));
+    _goalsets = reinterpret_cast<const PackedRange *>(_patterns + header->pattern_count);
+    _points   = reinterpret_cast<const PackedPoint *>(_goalsets + header->goalset_count);
+
+    auto valid = [](const PackedRange & r, size_t limit) {
+        return r.offset <= limit && r.count <= limit - r.offset;
+    };
+
+    for (size_t i = 0; i < header->pattern_count; ++i) {
+        const auto & p = _patterns[i];
+        if (!valid(p.walls,  header->point_count))   { return false; }
+        if (!valid(p.spaces, header->point_count))   { return false; }
+        if (!valid(p.boxes,  header->point_count))   { return false; }
+        if (!valid(p.goalsets, header->goalset_count)) { return false; }
+    }
+    for (size_t i = 0; i < header->goalset_count; ++i) {
+        if (!valid(_goalsets[i], header->point_count)) { return false; }
+    }
+
+    return true;
+}
+
+shared_ptr<const DeadlockDatabase> DeadlockDatabase::open(const string & path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) { return nullptr; }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) { ::close(fd); return nullptr; }
+
+    const size_t size = static_cast<size_t>(st.st_size);
+    void * mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) { return nullptr; }
+
+    auto db = make_shared<DeadlockDatabase>();
+    db->_mapped = mapped;
+    db->_size   = size;
+    if (!db->attach(static_cast<const unsigned char *>(mapped), size)) { return nullptr; }
+
+    return db;
+}
+
+vector<unsigned char> DeadlockDatabase::serialize(const vector<vector<DeadlockInfo>> & pattern_sets) {
+    vector<PackedPattern> patterns;
+    vector<PackedRange>   goalsets;
+    vector<PackedPoint>   points;
+
+    auto add_points = [&points](const vector<Point> & pts) {
+        PackedRange r{ static_cast<uint32_t>(points.size()), static_cast<uint32_t>(pts.size()) };
+        for (const auto & p: pts) {
+            points.push_back({ static_cast<int8_t>(p.x), static_cast<int8_t>(p.y) });
+        }
+        return r;
+    };
+
+    for (const auto & dlset: pattern_sets) {
+        for (const auto & dlinfo: dlset) {
+            PackedPattern pp;
+            pp.walls  = add_points(dlinfo.walls);
+            pp.spaces = add_points(dlinfo.spaces);
+            pp.boxes  = add_points(dlinfo.boxes);
+
+            pp.goalsets = { static_cast<uint32_t>(goalsets.size()),
+                            static_cast<uint32_t>(dlinfo.goalsets.size()) };
+            for (const auto & gs: dlinfo.goalsets) { goalsets.push_back(add_points(gs)); }
+
+            pp.independent_of_goals = dlinfo.independent_of_goals ? 1u : 0u;
+            patterns.push_back(pp);
+        }
+    }
+
+    Header header;
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version       = VERSION;
+    header.pattern_count = static_cast<uint32_t>(patterns.size());
+    header.goalset_count = static_cast<uint32_t>(goalsets.size());
+    header.point_count   = static_cast<uint32_t>(points.size());
+
+    vector<unsigned char> result;
+    auto append = [&result](const void * data, size_t size) {
+        const auto * bytes = static_cast<const unsigned char *>(data);
+        result.insert(end(result), bytes, bytes + size);
+    };
+
+    append(&header, sizeof(header));
+    append(patterns.data(), patterns.size() * sizeof(PackedPattern));
+    append(goalsets.data(), goalsets.size() * sizeof(PackedRange));
+    append(points.data(),   points.size()   * sizeof(PackedPoint));
+    return result;
+}
+
+shared_ptr<const DeadlockDatabase> DeadlockDatabase::pack(
+                        const vector<vector<DeadlockInfo>> & pattern_sets) {
+    auto db = make_shared<DeadlockDatabase>();
+    db->_owned = serialize(pattern_sets);
+
+    const bool attached = db->attach(db->_owned.data(), db->_owned.size());
+    assert(attached);
+    (void)attached;
+
+    return db;
+}
+
+bool DeadlockDatabase::write(const string & path, const vector<DeadlockInfo> & patterns) {
+    const auto data = serialize({ patterns });
+
+    ofstream fs(path, ios_base::out | ios_base::binary | ios_base::trunc);
+    fs.write(reinterpret_cast<const char *>(data.data()), static_cast<streamsize>(data.size()));
+    return static_cast<bool>(fs);
+}
+
+const DeadlockIndex & DeadlockDatabase::index() const {
+    call_once(_index_flag, [this]{ _index = DeadlockIndex{ *this }; });
+    return _index;
+}
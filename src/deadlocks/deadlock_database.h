@@ -0,0 +1,139 @@
+// Compact binary storage of deadlock patterns.
+// The file is read by mapping it into memory, the patterns are accessed in
+// place through views, nothing is parsed or copied. The compiled-in patterns
+// are packed into the same format in memory, so the users of the patterns
+// work with one representation.
+//
+// File layout (all integers are in the host byte order):
+//   Header
+//   PackedPattern[pattern_count]
+//   PackedRange[goalset_count]    - every goal set is a range of points
+//   PackedPoint[point_count]
+// Every range of a pattern references the goal sets or the points by offset and count.
+
+#ifndef DEADLOCK_DATABASE_H
+#define DEADLOCK_DATABASE_H
+
+#include "deadlock_info.h"
+#include "deadlock_index.h"
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+
+namespace Sokoban
+{
+struct PackedPoint {
+    std::int8_t x;
+    std::int8_t y;
+};
+
+struct PackedRange {
+    std::uint32_t offset;
+    std::uint32_t count;
+};
+
+struct PackedPattern {
+    PackedRange walls;
+    PackedRange spaces;
+    PackedRange boxes;
+    PackedRange goalsets;
+    std::uint32_t independent_of_goals;
+};
+
+// contiguous sequence of points of the database
+class PointSpan {
+    const PackedPoint * _first = nullptr;
+    size_t _count = 0u;
+
+public:
+    PointSpan() = default;
+    PointSpan(const PackedPoint * first, size_t count) : _first{ first }, _count{ count } { }
+
+    const PackedPoint * begin() const { return _first; }
+    const PackedPoint * end()   const { return _first + _count; }
+    size_t size() const { return _count; }
+    bool empty() const  { return _count == 0u; }
+};
+
+class DeadlockDatabase;
+
+// the view of one pattern, is valid while the database exists
+class DeadlockPatternView {
+    const DeadlockDatabase * _db;
+    const PackedPattern * _pattern;
+
+public:
+    DeadlockPatternView(const DeadlockDatabase & db, const PackedPattern & p)
+        : _db{ &db }, _pattern{ &p } { }
+
+    PointSpan walls()  const;
+    PointSpan spaces() const;
+    PointSpan boxes()  const;
+    size_t goalset_count() const { return _pattern->goalsets.count; }
+    PointSpan goalset(size_t index) const;
+    bool independent_of_goals() const { return _pattern->independent_of_goals != 0u; }
+};
+
+class DeadlockDatabase {
+public:
+    struct Header {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t pattern_count;
+        std::uint32_t goalset_count;
+        std::uint32_t point_count;
+    };
+
+    static constexpr char MAGIC[8] = { 'S', 'O', 'K', 'D', 'L', 'D', 'B', '\0' };
+    static constexpr std::uint32_t VERSION = 1u;
+
+private:
+    friend class DeadlockPatternView;
+
+    const unsigned char * _data = nullptr;
+    size_t _size = 0u;
+    std::vector<unsigned char> _owned; // the storage of the packed in-memory patterns
+    void * _mapped = nullptr;          // the storage of the mapped file
+
+    const Header        * _header   = nullptr;
+    const PackedPattern * _patterns = nullptr;
+    const PackedRange   * _goalsets = nullptr;
+    const PackedPoint   * _points   = nullptr;
+
+    mutable std::once_flag _index_flag;
+    mutable DeadlockIndex _index;
+
+    bool attach(const unsigned char * data, size_t size);
+
+public:
+    DeadlockDatabase() = default;
+    ~DeadlockDatabase();
+
+    DeadlockDatabase(const DeadlockDatabase &) = delete;
+    DeadlockDatabase & operator=(const DeadlockDatabase &) = delete;
+
+    // Maps the file into memory, returns nullptr if the file can't be read
+    // or its structure is inconsistent
+    static std::shared_ptr<const DeadlockDatabase> open(const std::string & path);
+
+    // Packs the patterns into the binary format in memory
+    static std::shared_ptr<const DeadlockDatabase> pack(
+                    const std::vector<std::vector<DeadlockInfo>> & pattern_sets);
+
+    // Writes the patterns in the binary format, returns false on i/o errors
+    static bool write(const std::string & path, const std::vector<DeadlockInfo> & patterns);
+    static std::vector<unsigned char> serialize(
+                    const std::vector<std::vector<DeadlockInfo>> & pattern_sets);
+
+    size_t size() const { return _header->pattern_count; }
+    DeadlockPatternView pattern(size_t index) const { return { *this, _patterns[index] }; }
+
+    // the index of the patterns by neighbourhood, it is built on the first request
+    const DeadlockIndex & index() const;
+};
+}
+
+#endif
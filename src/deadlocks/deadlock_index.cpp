@@ -0,0 +1,67 @@
+#include "deadlock_index.h"
+#include "deadlock_database.h"
+
+#include <algorithm>
+#include <limits>
+
+using namespace Sokoban;
+using namespace std;
+
+DeadlockIndex::DeadlockIndex(const DeadlockDatabase & db)
+    : _size{ db.size() } {
+    constexpr size_t MAX_CELLS = numeric_limits<signature_t>::digits;
+
+    auto add_cell = [this](const PackedPoint & pp) {
+        const Point p{ pp.x, pp.y };
+        auto it = find_if(begin(_cells), end(_cells),
+                          [&p](const Point & c){ return c.x == p.x && c.y == p.y; });
+        if (it == end(_cells) && _cells.size() < MAX_CELLS) { _cells.push_back(p); }
+    };
+
+    for (size_t i = 0; i < _size; ++i) {
+        const auto dlinfo = db.pattern(i);
+        for (const auto & p: dlinfo.walls())  { add_cell(p); }
+        for (const auto & p: dlinfo.spaces()) { add_cell(p); }
+    }
+
+    for (size_t i = 0; i < _size; ++i) {
+        const auto dlinfo = db.pattern(i);
+        signature_t cells = 0u, walls = 0u;
+        for (const auto & p: dlinfo.walls())  { walls |= cell_bit({ p.x, p.y }); }
+        for (const auto & p: dlinfo.spaces()) { cells |= cell_bit({ p.x, p.y }); }
+        cells |= walls;
+
+        auto it = find_if(begin(_groups), end(_groups),
+                          [cells](const Group & g){ return g.cells == cells; });
+        if (it == end(_groups)) {
+            _groups.push_back({ cells, {} });
+            it = prev(end(_groups));
+        }
+        it->by_walls[walls].push_back(i);
+    }
+}
+
+DeadlockIndex::signature_t DeadlockIndex::cell_bit(const Point & p) const {
+    auto it = find_if(begin(_cells), end(_cells),
+                      [&p](const Point & c){ return c.x == p.x && c.y == p.y; });
+
+    if (it == end(_cells)) { return 0u; }
+    return signature_t{ 1u } << distance(begin(_cells), it);
+}
+
+void DeadlockIndex::candidates(signature_t walls, signature_t inside,
+                               vector<size_t> & result) const {
+    result.clear();
+
+    for (const auto & group: _groups) {
+        // every tested cell must be inside the board
+        if ((inside & group.cells) != group.cells) { continue; }
+
+        auto it = group.by_walls.find(walls & group.cells);
+        if (it == group.by_walls.end()) { continue; }
+
+        result.insert(end(result), begin(it->second), end(it->second));
+    }
+
+    sort(begin(result), end(result));
+}
@@ -0,0 +1,55 @@
+// Index of deadlock patterns by their wall/space neighbourhood.
+// All distinct cells tested by the patterns (walls and spaces) form the
+// neighbourhood, every cell has its bit in a 64-bit signature. The patterns
+// which test the same set of cells are grouped, inside a group they are
+// bucketed by their wall bits. So for a tile with a known signature only
+// one hash lookup per group is needed to find the candidate patterns.
+// The index is a necessary condition only: the candidates must be verified,
+// and the cells which don't fit in the signature are not indexed at all.
+
+#ifndef DEADLOCK_INDEX_H
+#define DEADLOCK_INDEX_H
+
+#include "deadlock_info.h"
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+namespace Sokoban
+{
+class DeadlockDatabase;
+
+class DeadlockIndex {
+public:
+    using signature_t = std::uint64_t;
+
+private:
+    struct Group {
+        signature_t cells;
+        std::unordered_map<signature_t, std::vector<size_t>> by_walls;
+    };
+
+    size_t _size = 0u;
+    std::vector<Point> _cells;
+    std::vector<Group> _groups;
+
+    signature_t cell_bit(const Point & p) const;
+
+public:
+    DeadlockIndex() = default;
+    explicit DeadlockIndex(const DeadlockDatabase & db);
+
+    // the cells of the neighbourhood, i-th cell corresponds to i-th bit of a signature
+    const std::vector<Point> & cells() const { return _cells; }
+
+    size_t size() const { return _size; }
+
+    // Returns the indexes of the patterns of the database (in ascending order), which may match
+    // the neighbourhood with <walls> bits set for wall cells and <inside> bits
+    // set for the cells inside the board
+    void candidates(signature_t walls, signature_t inside, std::vector<size_t> & result) const;
+};
+}
+
+#endif
@@ -1,6 +1,10 @@
 #include "deadlocks1x2.h"
 #include "deadlocks2x2.h"
 #include "manual_deadlocks.h"
+#include "deadlocks.h"
+#include "deadlock_database.h"
+
+#include <mutex>
 
 using namespace std;
 
@@ -13,4 +17,21 @@ vector<vector<Sokoban::DeadlockInfo>> generated_deadlocks = {
     manual_deadlocks,
 };
 
+namespace
+{
+mutex active_mutex;
+shared_ptr<const DeadlockDatabase> active_db;
+}
+
+shared_ptr<const DeadlockDatabase> active_deadlocks() {
+    lock_guard<mutex> lock(active_mutex);
+    if (!active_db) { active_db = DeadlockDatabase::pack(generated_deadlocks); }
+    return active_db;
+}
+
+void set_active_deadlocks(shared_ptr<const DeadlockDatabase> db) {
+    lock_guard<mutex> lock(active_mutex);
+    active_db = move(db);
+}
+
 }
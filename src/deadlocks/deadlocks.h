@@ -3,9 +3,18 @@
 
 #include "deadlock_info.h"
 
+#include <memory>
+
 namespace Sokoban
 {
+    class DeadlockDatabase;
+
     extern std::vector<std::vector<Sokoban::DeadlockInfo>> generated_deadlocks;
+
+    // The patterns used by the solver: the loaded database if any,
+    // the compiled-in patterns packed on the first request otherwise
+    std::shared_ptr<const DeadlockDatabase> active_deadlocks();
+    void set_active_deadlocks(std::shared_ptr<const DeadlockDatabase> db);
 }
 
 #endif
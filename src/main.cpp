@@ -1,17 +1,263 @@
 #include <iostream>
+#include <thread>
+#include <string>
+#include <optional>
+#include <chrono>
+#include <sstream>
+#include <iterator>
+#include <limits>
+#include <cstdint>
+#include <cstdlib>
+#include <cerrno>
+#include <cctype>
 #include "sokoban_solver.h"
+#include "sokoban_service.h"
+#include "sokoban_portfolio.h"
+#include "sokoban_solution_cache.h"
+#include "string_join.h"
+#include "deadlocks.h"
+#include "deadlock_database.h"
 
 using namespace std;
 
-int main() {
+namespace
+{
+// the whole argument as a number within [0, max], nullopt otherwise
+optional<uint64_t> parse_number(const char * text, uint64_t max, int base = 10) {
+    // strtoull takes a negative number modulo 2^64
+    if (!isdigit(static_cast<unsigned char>(text[0]))) { return nullopt; }
+
+    errno = 0;
+    char * end = nullptr;
+    const unsigned long long value = strtoull(text, &end, base);
+    if (errno != 0 || *end != '\0' || value > max) { return nullopt; }
+    return value;
+}
+}
+
+int main(int argc, char * argv[]) {
     Sokoban::Solver solver;
-    if (!solver.read_level_data(cin)) {
+    optional<Sokoban::AnytimeOptions> anytime;
+    bool optimize = false;
+    bool lurd = false;
+    optional<string> socket_path;
+    shared_ptr<Sokoban::SolutionCache> cache;
+    Sokoban::CheckpointOptions checkpoint;
+    optional<Sokoban::ExternalSearchOptions> external;
+    size_t bitstate_mb = 0u;
+    optional<Sokoban::BeamOptions> beam;
+    optional<Sokoban::PortfolioOptions> portfolio;
+    Sokoban::ServiceOptions service_options;
+
+    // the next argument as a number, an invalid one fails the parsing
+    bool valid = true;
+    int i = 1;
+    auto number = [&](uint64_t max, int base = 10) -> uint64_t {
+        const auto value = parse_number(argv[++i], max, base);
+        valid = valid && value.has_value();
+        return value.value_or(0u);
+    };
+    constexpr uint64_t MAX_COUNT = numeric_limits<size_t>::max();
+    constexpr uint64_t MAX_MB = MAX_COUNT >> 20;
+    constexpr uint64_t MAX_DURATION = static_cast<uint64_t>(numeric_limits<int64_t>::max()) / 1000u;
+
+    for (; i < argc && valid; ++i) {
+        const string arg = argv[i];
+        if (arg == "--deadlocks" && i + 1 < argc) {
+            auto db = Sokoban::DeadlockDatabase::open(argv[++i]);
+            if (!db) {
+                cout << "Invalid deadlock database " << argv[i] << endl;
+                return EXIT_FAILURE;
+            }
+            Sokoban::set_active_deadlocks(move(db));
+        } else if (arg == "--seed" && i + 1 < argc) {
+            solver.set_hash_seed(number(numeric_limits<uint64_t>::max(), 0));
+        } else if (arg == "--anytime" && i + 1 < argc) {
+            anytime.emplace();
+            anytime->time_budget = chrono::milliseconds{ number(MAX_DURATION) };
+        } else if (arg == "--optimize") {
+            optimize = true;
+        } else if (arg == "--symmetry") {
+            solver.set_symmetry_pruning(true);
+        } else if (arg == "--lurd") {
+            lurd = true;
+        } else if (arg == "--cache" && i + 1 < argc) {
+            cache = Sokoban::SolutionCache::open(argv[++i]);
+            if (!cache) { cout << "The solution cache " << argv[i] << " can't be used" << endl; }
+        } else if (arg == "--bitstate" && i + 1 < argc) {
+            bitstate_mb = number(MAX_MB);
+        } else if (arg == "--checkpoint" && i + 1 < argc) {
+            checkpoint.path = argv[++i];
+        } else if (arg == "--checkpoint-interval" && i + 1 < argc) {
+            checkpoint.interval = chrono::seconds{ number(MAX_DURATION) };
+        } else if (arg == "--external" && i + 1 < argc) {
+            external.emplace();
+            external->directory = argv[++i];
+        } else if (arg == "--external-run-mb" && i + 1 < argc && external.has_value()) {
+            external->run_bytes = number(MAX_MB) << 20;
+        } else if (arg == "--beam" && i + 1 < argc) {
+            beam.emplace();
+            beam->width = number(MAX_COUNT);
+        } else if (arg == "--beam-max" && i + 1 < argc && beam.has_value()) {
+            beam->max_width = number(MAX_COUNT);
+        } else if (arg == "--portfolio" && i + 1 < argc) {
+            portfolio.emplace();
+            portfolio->time_budget = chrono::milliseconds{ number(MAX_DURATION) };
+        } else if (arg == "--serve" && i + 1 < argc) {
+            socket_path = argv[++i];
+        } else if (arg == "--workers" && i + 1 < argc) {
+            service_options.workers = number(MAX_COUNT);
+        } else if (arg == "--max-states" && i + 1 < argc) {
+            service_options.max_states = number(MAX_COUNT);
+        } else if (arg == "--max-memory" && i + 1 < argc) {
+            service_options.max_memory = number(MAX_MB) << 20;
+        } else {
+            valid = false;
+        }
+    }
+    if (!valid) {
+        cout << "Usage: " << argv[0]
+             << " [--deadlocks <file>] [--seed <n>] [--anytime <ms, 0 - unlimited>]"
+             << " [--optimize] [--lurd] [--symmetry] [--bitstate <MB>] [--cache <path>]"
+             << " [--checkpoint <file> [--checkpoint-interval <s>]]"
+             << " [--external <dir> [--external-run-mb <n>]] [--beam <width> [--beam-max <width>]]"
+             << " [--portfolio <ms, 0 - unlimited>] < level" << endl
+             << "       " << argv[0]
+             << " [--deadlocks <file>] [--cache <path>] --serve <socket> [--workers <n>] [--max-states <n>]"
+             << " [--max-memory <MB>]"
+             << endl;
+        return EXIT_FAILURE;
+    }
+
+    if (socket_path.has_value()) {
+        service_options.cache = cache;
+        Sokoban::SolverService service(socket_path.value(), service_options);
+        if (!service.listen()) {
+            cout << "Can't listen on " << socket_path.value() << endl;
+            return EXIT_FAILURE;
+        }
+        service.serve();
+        return EXIT_SUCCESS;
+    }
+
+    // the searches of the portfolio read the level themselves
+    const string level(istreambuf_iterator<char>{ cin }, {});
+    istringstream level_stream(level);
+
+    solver.set_preprocess_threads(thread::hardware_concurrency());
+    if (!solver.read_level_data(level_stream)) {
         cout << "Invalid input data" << endl;
         return EXIT_FAILURE;
     }
     solver.print_information();
 
-    if (solver.solve()) {
+    auto optimize_solution = [&solver, optimize]{
+        if (!optimize) { return; }
+
+        Sokoban::OptimizerOptions options;
+        options.threads = thread::hardware_concurrency();
+        const size_t removed = solver.optimize_solution(options);
+        cout << "Post-optimization removed " << removed << " pushes" << endl;
+    };
+    auto print_moves = [&solver, lurd]{
+        if (!lurd) { return; }
+
+        const auto moves = solver.solution_moves();
+        if (moves.has_value()) { cout << "Moves: " << moves.value() << endl; }
+        else                   { cout << "Moves can't be reconstructed" << endl; }
+    };
+
+    if (external.has_value()) {
+        external->on_layer = [](size_t depth, uint64_t layer_size, uint64_t closed_size) {
+            cout << "Layer " << depth << ": " << layer_size << " states, " << closed_size << " in total" << endl;
+        };
+        if (solver.solve_external(external.value())) {
+            solver.print_solution_format1(cout);
+            print_moves();
+        } else if (solver.stop_reason() == Sokoban::StopReason::IoError) {
+            cout << "External search failed: I/O error in " << external->directory << endl;
+            return EXIT_FAILURE;
+        } else {
+            cout << "No solution" << endl;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    if (portfolio.has_value()) {
+        Sokoban::Portfolio racer(portfolio.value());
+        const auto result = racer.solve(level);
+        if (result.has_value()) {
+            cout << "Solution (" << to_string(result->winner) << ", " << result->states << " states, "
+                 << result->time.count() << " ms):" << endl
+                 << string_join(result->solution, " ") << endl;
+            if (lurd && result->moves.has_value()) { cout << "Moves: " << result->moves.value() << endl; }
+        } else {
+            cout << "No solution" << endl;
+        }
+        racer.print_statistics(cout);
+        return EXIT_SUCCESS;
+    }
+
+    if (beam.has_value()) {
+        beam->on_pass = [](size_t width, size_t depth, size_t states) {
+            cout << "Beam " << width << ": " << depth << " pushes deep, " << states << " states" << endl;
+        };
+        if (solver.solve_beam(beam.value())) {
+            optimize_solution();
+            solver.print_solution_format1(cout);
+            print_moves();
+        } else {
+            cout << "No solution" << endl;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    if (!anytime.has_value()) {
+        if (cache && solver.load_solution(*cache)) {
+            solver.print_solution_format1(cout);
+            print_moves();
+            return EXIT_SUCCESS;
+        }
+
+        // the bitstate search can't be resumed
+        if (bitstate_mb != 0u) { solver.set_bitstate(bitstate_mb << 20); }
+        if (!checkpoint.path.empty()) {
+            checkpoint.on_checkpoint = [](const Sokoban::CheckpointStats & stats) {
+                cout << "Checkpoint: " << stats.states << " states, " << stats.bytes << " bytes, "
+                     << stats.write_ms << " ms" << endl;
+            };
+            solver.set_checkpoint(checkpoint);
+            if (solver.resume(checkpoint.path)) {
+                cout << "Resumed from " << checkpoint.path << " (" << solver.state_count() << " states)" << endl;
+            }
+        }
+
+        const auto start = chrono::steady_clock::now();
+        const bool solved = solver.solve();
+        if (const auto stats = solver.bitstate_stats(); stats.has_value()) {
+            cout << "Bitstate: " << stats->memory_bytes << " bytes of the filter, "
+                 << stats->search_memory_bytes << " bytes in total, " << stats->states << " states, "
+                 << "omission probability " << stats->omission_probability
+                 << ", ~" << stats->expected_omissions << " states omitted" << endl;
+        }
+        if (solved) {
+            const auto search_time = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start);
+            optimize_solution();
+            if (cache) { solver.store_solution(*cache, search_time); }
+            solver.print_solution_format1(cout);
+            print_moves();
+        }
+        return EXIT_SUCCESS;
+    }
+
+    auto print_improved = [](const vector<Sokoban::PushInfo> & pushes, double weight) {
+        cout << "Found solution: " << pushes.size() << " pushes (weight " << weight << ")" << endl;
+    };
+    if (solver.solve_anytime(anytime.value(), print_improved)) {
+        optimize_solution();
         solver.print_solution_format1(cout);
+        cout << (solver.solution_is_optimal() ? "Optimal" : "Not proven optimal")
+             << ", " << solver.solution()->size() << " pushes" << endl;
+        print_moves();
     }
 }
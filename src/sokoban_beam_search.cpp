@@ -0,0 +1,120 @@
+#include "sokoban_beam_search.h"
+#include "sokoban_board.h"
+#include "sokoban_board_graphs.h"
+#include "sokoban_boxstate.h"
+#include "sokoban_solver_context.h"
+
+#include <unordered_set>
+#include <algorithm>
+#include <limits>
+
+using namespace Sokoban;
+using namespace std;
+
+namespace
+{
+constexpr uint32_t ROOT = numeric_limits<uint32_t>::max();
+
+struct Candidate {
+    size_t bound;           // the push lower bound
+    size_t goals;           // the boxes on goals in their order
+    size_t order;           // of the generation, the older candidate wins a tie
+    uint32_t parent;        // the entry of the parent in the parent store
+    PushInfo push;
+    BoxState state;
+};
+
+bool better(const Candidate & l, const Candidate & r) {
+    if (l.bound != r.bound) { return l.bound < r.bound; }
+    if (l.goals != r.goals) { return l.goals > r.goals; }
+    return l.order < r.order;
+}
+
+// the hashes are the keys already, they are not hashed again
+struct Identity {
+    size_t operator()(boxhash_t hash) const noexcept { return static_cast<size_t>(hash); }
+};
+}
+
+BeamSearch::BeamSearch(Board & board, const SolverContext & context, const Options & options)
+    : _board{ board }, _context{ context }, _options{ options } {
+}
+
+optional<vector<PushInfo>> BeamSearch::solve() {
+    if (_board.is_complete()) { return vector<PushInfo>{}; }
+
+    // every pass starts from the initial state
+    const BoxState start = _board.current_state();
+    const size_t max_width = max(_options.width, _options.max_width);
+    for (size_t width = max<size_t>(1u, _options.width); ; width *= 2u) {
+        width = min(width, max_width);
+        auto solution = search(start, width);
+        if (solution.has_value() || width == max_width || cancelled()) { return solution; }
+    }
+}
+
+optional<vector<PushInfo>> BeamSearch::search(const BoxState & start, size_t width) {
+    _parents.clear();
+    _kept = 1u;
+    _pruned = _depth_limited = false;
+
+    // the states of the current layer and their entries in the parent store
+    vector<pair<uint32_t, BoxState>> layer{ { ROOT, start } };
+    unordered_set<boxhash_t, Identity> kept{ layer.front().second.hash(_context) };
+    unordered_set<boxhash_t, Identity> generated;
+    vector<Candidate> candidates;
+
+    size_t depth = 0u;
+    for (; !layer.empty() && (_options.max_depth == 0u || depth < _options.max_depth); ++depth) {
+        candidates.clear();
+        generated.clear();
+
+        for (const auto & [index, state]: layer) {
+            if (cancelled()) { return nullopt; }
+
+            _board.set_boxstate(state);
+            for (const auto & [pushinfo, stats]: _board.possible_pushes()) {
+                _board.set_boxstate_and_push(state, pushinfo);
+                if (_board.is_complete()) {
+                    if (_options.on_pass) { _options.on_pass(width, depth + 1, _kept); }
+                    return recover_path(index, pushinfo);
+                }
+
+                const BoxState new_state = _board.current_state();
+                const boxhash_t hash = new_state.hash(_context);
+                if (kept.count(hash) != 0u || !generated.insert(hash).second) { continue; }
+
+                const size_t bound = _board.push_lower_bound();
+                if (bound == BoardGraphs::UNREACHABLE) { continue; }
+                candidates.push_back({ bound, stats.ordered_boxes_on_goals_count, candidates.size(),
+                                       index, pushinfo, new_state });
+            }
+        }
+
+        if (candidates.size() > width) {
+            _pruned = true;
+            nth_element(candidates.begin(), candidates.begin() + static_cast<ptrdiff_t>(width),
+                        candidates.end(), better);
+            candidates.erase(candidates.begin() + static_cast<ptrdiff_t>(width), candidates.end());
+        }
+
+        layer.clear();
+        for (const auto & candidate: candidates) {
+            layer.emplace_back(static_cast<uint32_t>(_parents.size()), candidate.state);
+            _parents.push_back({ candidate.parent, candidate.push });
+            kept.insert(candidate.state.hash(_context));
+        }
+        _kept += candidates.size();
+    }
+
+    _depth_limited = !layer.empty();
+    if (_options.on_pass) { _options.on_pass(width, depth, _kept); }
+    return nullopt;
+}
+
+vector<PushInfo> BeamSearch::recover_path(uint32_t index, const PushInfo & last) const {
+    vector<PushInfo> path{ last };
+    for (; index != ROOT; index = _parents[index].parent) { path.push_back(_parents[index].push); }
+    reverse(path.begin(), path.end());
+    return path;
+}
@@ -0,0 +1,71 @@
+#ifndef SOKOBAN_BEAM_SEARCH_H
+#define SOKOBAN_BEAM_SEARCH_H
+
+#include "sokoban_common.h"
+#include "sokoban_pushinfo.h"
+
+#include <vector>
+#include <optional>
+#include <functional>
+#include <atomic>
+#include <cstdint>
+
+namespace Sokoban
+{
+class Board;
+class BoxState;
+struct SolverContext;
+
+// The parameters of the beam search
+struct BeamOptions {
+    size_t width = 1000u;       // the states kept for every push depth
+    size_t max_width = 0u;      // the failed search restarts with the doubled width up to it
+    size_t max_depth = 0u;      // 0 - until the beam is empty
+    const std::atomic<bool> * cancel = nullptr;  // the search stops when the flag is set
+    // is called after every pass with its width, depth and the number of kept states
+    std::function<void(size_t, size_t, size_t)> on_pass;
+};
+
+// Breadth-first search by pushes which keeps only the best <width> new states
+// of every layer: the least push lower bound, then the most boxes on goals in
+// their order. A state is stored as one entry of the parent store (the parent
+// entry and the push) and its hash in the set of the kept states, so the memory
+// is O(width * depth) besides the states of two layers. A state whose hash is
+// kept already is skipped, so the beam doesn't return to the earlier layers.
+class BeamSearch {
+public:
+    using Options = BeamOptions;
+
+private:
+    struct Parent {
+        std::uint32_t parent;
+        PushInfo push;
+    };
+
+    Board & _board;
+    const SolverContext & _context;
+    Options _options;
+    std::vector<Parent> _parents;
+    size_t _kept = 0u;
+    bool _pruned = false, _depth_limited = false;
+
+    std::optional<std::vector<PushInfo>> search(const BoxState & start, size_t width);
+    std::vector<PushInfo> recover_path(std::uint32_t index, const PushInfo & last) const;
+    bool cancelled() const {
+        return _options.cancel != nullptr && _options.cancel->load(std::memory_order_relaxed);
+    }
+
+public:
+    BeamSearch(Board & board, const SolverContext & context, const Options & options);
+
+    // nullopt if no pass found a solution
+    std::optional<std::vector<PushInfo>> solve();
+    // the number of the states kept by the last pass
+    size_t state_count() const { return _kept; }
+    // the last pass dropped the states beyond the width / stopped at the depth limit
+    bool pruned() const { return _pruned; }
+    bool depth_limited() const { return _depth_limited; }
+};
+}
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef SOKOBAN_BITSTATE_TABLE_H
+#define SOKOBAN_BITSTATE_TABLE_H
+
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <cmath>
+#include <cstdint>
+
+#include "sokoban_boxstate.h"
+
+namespace Sokoban
+{
+
+// The closed set of the probabilistic (bitstate) search: a Bloom filter over
+// the Zobrist hashes of the states. A state costs a few bits instead of a whole
+// BoxState, but a new state whose bits are all set by other states is taken
+// as visited and is omitted from the search, so the search may miss a solution.
+// The ids of the inserted states are assigned in the insertion order, like the
+// ids of TranspositionTable.
+class BitstateTable {
+    std::vector<std::uint64_t> _words;
+    std::uint64_t _bit_count;
+    size_t _hash_count;
+    const SolverContext & _context;
+
+    size_t _count = 0u;
+    std::uint64_t _set_bits = 0u;
+    double _expected_omissions = 0.0;
+
+    // the hash functions are derived from one hash by double hashing
+    static std::uint64_t mix(std::uint64_t x) {
+        x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ull;
+        x ^= x >> 27; x *= 0x94d049bb133111ebull;
+        return x ^ (x >> 31);
+    }
+
+public:
+    // the filter of <bytes> (rounded up to 8) and <hash_count> bits per state
+    BitstateTable(const SolverContext & context, size_t bytes, size_t hash_count)
+        : _words(std::max<size_t>(1u, (bytes + 7u) / 8u), 0u), _bit_count{ _words.size() * 64u },
+          _hash_count{ std::max<size_t>(1u, hash_count) }, _context{ context } { }
+
+    size_t size() const { return _count; }
+    size_t memory_bytes() const { return _words.size() * sizeof(std::uint64_t); }
+    size_t hash_count() const { return _hash_count; }
+
+    // the probability that the next new state is taken as visited
+    double omission_probability() const {
+        return std::pow(static_cast<double>(_set_bits) / static_cast<double>(_bit_count),
+                        static_cast<double>(_hash_count));
+    }
+    // the estimated number of the new states taken as visited so far: for
+    // every inserted state p / (1 - p) new states are omitted on average
+    double expected_omissions() const { return _expected_omissions; }
+
+    void clear() {
+        std::fill(_words.begin(), _words.end(), 0u);
+        _count = 0u;
+        _set_bits = 0u;
+        _expected_omissions = 0.0;
+    }
+
+    std::pair<bool, unsigned> insert_state(const BoxState & newstate) {
+        const double probability = omission_probability();
+        // the boxes and the player share the bitstrings of the Zobrist hash, so a box
+        // and the player swapping their tiles give one hash; the player is mixed in apart
+        const std::uint64_t boxes = newstate.hash(_context) ^ _context.zhash.hash(newstate.player_index);
+        const std::uint64_t hash = mix(boxes ^ mix(newstate.player_index + 1u));
+        const std::uint64_t h1 = hash, h2 = (hash >> 32) | 1u;
+        bool inserted = false;
+        for (size_t i = 0; i < _hash_count; ++i) {
+            const std::uint64_t bit = (h1 + i * h2) % _bit_count;
+            std::uint64_t & word = _words[bit >> 6];
+            const std::uint64_t mask = 1ull << (bit & 63u);
+            if ((word & mask) == 0u) {
+                word |= mask;
+                ++_set_bits;
+                inserted = true;
+            }
+        }
+
+        // the visited states have no ids, they are never read back
+        if (!inserted) { return std::make_pair(false, 0u); }
+        if (probability < 1.0) { _expected_omissions += probability / (1.0 - probability); }
+        return std::make_pair(true, static_cast<unsigned>(_count++));
+    }
+};
+
+}
+
+#endif
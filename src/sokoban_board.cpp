@@ -6,34 +6,117 @@
 
 #include <algorithm>
 #include <iostream>
+#include <iomanip>
 
 using namespace Sokoban;
 using namespace std;
 
-bool Board::initialize(std::vector<Tile> && maze, size_t width, size_t height) {
+bool Board::initialize(std::vector<Tile> && maze, size_t width, size_t height,
+                       ThreadPool * pool) {
     assert(maze.size() <= MAX_TILE_COUNT);
 
+    _preprocess_timings.clear();
     if (!_state.initialize(move(maze), width, height)) return false;
     if (_state.is_complete()) { return true; }
-    if (!_graphs.initialize(_state))   return false;
-    if (!_dltester.initialize(_state)) return false;
+    if (!_graphs.build_graphs(_state)) return false;
 
+    TaskGraph tasks;
+    _graphs.schedule(tasks, _state);
+    _dltester.schedule(tasks, _state);
+
+    if (pool != nullptr) { tasks.run(*pool); }
+    else {
+        ThreadPool current_thread;
+        tasks.run(current_thread);
+    }
+    _graphs.complete(_state);
+
+    _preprocess_timings = tasks.timings();
     return true;
 }
 
 void Board::print_information() const {
     cout << "LEVEL: " << endl;
     _state.print();
+    if (symmetry_count() > 0u) { cout << "Symmetries: " << symmetry_count() << endl; }
     print_graphs();
+    print_preprocess_timings();
+}
+
+void Board::print_preprocess_timings() const {
+    cout << "Preprocessing:\n";
+    for (const auto & [name, task_count, elapsed_ms, busy_ms]: _preprocess_timings) {
+        cout << "  " << left << setw(20) << name << right
+             << setw(5) << task_count << " tasks, "
+             << fixed << setprecision(3)
+             << setw(9) << elapsed_ms << " ms elapsed, "
+             << setw(9) << busy_ms    << " ms busy\n";
+    }
+    cout.unsetf(ios_base::floatfield);
+    cout << endl;
 }
 
-BoxState Board::current_state() const {
+BoxState Board::current_state() {
     BoxState bs = _state.current_boxstate();
     bs.player_index = _graphs.min_move_index(bs.player_index);
 
     return bs;
 }
 
+BoxState Board::make_state(const index_t * boxes, index_t player) const {
+    BoxState bs;
+    bs.player_index = player;
+    for (size_t i = 0; i < _state.box_count(); ++i) {
+        bs.box_indexes[i] = boxes[i];
+        bs.box_bits[boxes[i]] = true;
+        bs.goal_bits |= _state.goal_bit(boxes[i]);
+    }
+    return bs;
+}
+
+pair<BoxState, BoxState> Board::current_state_and_key() {
+    const auto & symmetries = _state.symmetries();
+    const size_t count = _state.box_count();
+
+    BoxState bs = _state.current_boxstate();
+    _graphs.min_move_indexes(bs.player_index, symmetries, _symmetric_players);
+    bs.player_index = _symmetric_players[0];
+
+    BoxState key = bs;
+    sort(begin(key.box_indexes), begin(key.box_indexes) + count);
+
+    array<index_t, MAX_BOX_COUNT> boxes;
+    for (size_t si = 0; si < symmetries.size(); ++si) {
+        for (size_t i = 0; i < count; ++i) { boxes[i] = symmetries[si][bs.box_indexes[i]]; }
+        sort(begin(boxes), begin(boxes) + count);
+
+        const index_t player = _symmetric_players[si + 1u];
+        const auto first = begin(boxes), last = begin(boxes) + count;
+        const auto key_first = begin(key.box_indexes), key_last = begin(key.box_indexes) + count;
+        if (lexicographical_compare(first, last, key_first, key_last) ||
+            (equal(first, last, key_first) && player < key.player_index)) {
+            copy(begin(boxes), begin(boxes) + count, begin(key.box_indexes));
+            key.player_index = player;
+        }
+    }
+
+    if (!symmetries.empty()) {
+        key.box_bits.reset();
+        for (size_t i = 0; i < count; ++i) { key.box_bits[key.box_indexes[i]] = true; }
+    }
+    return { bs, key };
+}
+
+size_t Board::push_lower_bound() const {
+    size_t result = 0u;
+    for (size_t i = 0; i < _state.box_count(); ++i) {
+        const auto d = _graphs.box_distance(i, _state.box_index(i));
+        if (d == BoardGraphs::UNREACHABLE) { return BoardGraphs::UNREACHABLE; }
+        result += d;
+    }
+    return result;
+}
+
 void Board::set_boxstate_and_push(const BoxState & bs, const PushInfo & pi) {
     _state.set_boxstate(bs);
     _state.apply_push(pi);
@@ -78,7 +161,7 @@ vector<pair<PushInfo, typename Board::StateStats>> Board::possible_pushes() {
 
             const PushInfo pi{ ibox, ibox_dest };
             StateStats stats{};
-            /* stats.boxes_on_goals_count         = _state.boxes_on_goals(); */
+            stats.boxes_on_goals_count         = _state.boxes_on_goals();
             stats.ordered_boxes_on_goals_count = _graphs.ordered_boxes_on_goals(_state);
             stats.push_distances       = _graphs.push_distances(_state, i, pi);
 
@@ -90,6 +173,25 @@ vector<pair<PushInfo, typename Board::StateStats>> Board::possible_pushes() {
     return result;
 }
 
+bool Board::is_push_legal(const PushInfo & pi) {
+    const size_t width = _state.width();
+    const index_t from = pi.from(), to = pi.to();
+    if (from >= _state.tile_count() || to >= _state.tile_count()) { return false; }
+
+    // the tiles must be neighbours in a row or in a column
+    const bool horizontal = (from + 1 == to || to + 1 == from) && from / width == to / width;
+    const bool vertical   = from + width == to || to + width == from;
+    if (!horizontal && !vertical) { return false; }
+
+    // the player stands on the opposite side of the box
+    const size_t player = 2u * from - to;
+    if (to > 2u * from || player >= _state.tile_count()) { return false; }
+    if (horizontal && player / width != from / width) { return false; }
+
+    return _state.is_box(from) && !_state.is_box(to) && !_state.is_wall(to)
+        && _graphs.narrowed_moves_bitset(_state.player())[player];
+}
+
 void Board::print_graphs() const {
     for (size_t i = 0; i < _state.box_count(); ++i) {
         const index_t boxi = _state.box_indexes()[i];
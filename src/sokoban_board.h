@@ -5,6 +5,7 @@
 #include "sokoban_board_state.h"
 #include "sokoban_board_graphs.h"
 #include "sokoban_deadlock_tester.h"
+#include "task_graph.h"
 
 #include <vector>
 #include <bitset>
@@ -20,6 +21,9 @@ class Board {
     BoardGraphs    _graphs;
     DeadlockTester _dltester;
 
+    std::vector<TaskGraph::StageTiming> _preprocess_timings;
+    std::vector<index_t> _symmetric_players;
+
 public:
     struct StateStats {
         size_t boxes_on_goals_count;
@@ -34,19 +38,39 @@ public:
     Board & operator=(const Board &) = delete;
     Board & operator=(Board &&) = delete;
 
-    bool initialize(std::vector<Tile> && maze, size_t w, size_t h);
+    // the independent preprocessing stages are executed on the <pool>,
+    // without the pool everything is calculated in the current thread;
+    // the board may be initialized again with another level
+    bool initialize(std::vector<Tile> && maze, size_t w, size_t h, ThreadPool * pool = nullptr);
     void print_information() const;
+    void print_preprocess_timings() const;
 
     size_t box_count() const { return _state.box_count(); }
 
-    BoxState current_state() const;
+    BoxState current_state();
+    // the state with the boxes (in the order of their identities) and the player
+    BoxState make_state(const index_t * boxes, index_t player) const;
+    // The current state and its key for the transposition table: the least of
+    // the symmetric variants of the state (by the sorted box indexes, then by
+    // the player), so all symmetric states share one key
+    std::pair<BoxState, BoxState> current_state_and_key();
+    size_t symmetry_count() const { return _state.symmetries().size(); }
     void set_boxstate(const BoxState & bs);
     void set_boxstate_and_push(const BoxState & bs, const PushInfo & pi);
 
     bool is_complete() const { return _state.is_complete(); }
 
+    // the admissible estimate of the number of pushes to complete the current state:
+    // the sum of the distances of the boxes to their nearest goals, UNREACHABLE
+    // if any box can't reach its goals
+    size_t push_lower_bound() const;
+
     std::vector<std::pair<PushInfo, StateStats>> possible_pushes();
 
+    // checks that the push is allowed by the rules in the current state
+    // (isn't restricted by the routes or the deadlock patterns)
+    bool is_push_legal(const PushInfo & pi);
+
     void print_state() const { _state.print(); }
     void print_graphs() const;
 };
@@ -2,6 +2,8 @@
 #include "sokoban_board_state.h"
 
 #include <set>
+#include <limits>
+#include <algorithm>
 #include <iostream>
 #include "string_join.h"
 
@@ -9,12 +11,44 @@ using namespace Sokoban;
 using namespace std;
 
 bool BoardGraphs::initialize(const BoardState & state) {
+    if (!build_graphs(state)) { return false; }
+
+    calculate_goals_distances(state);
+    bipartite_matching(state);
+    calculate_goals_order(state);
+    for (size_t i = 0; i < _box_count; ++i) { calculate_route(i); }
+    complete(state);
+
+    return true;
+}
+
+// The stages of the preprocessing: the distances depend on the graphs, the matching
+// depends on the distances, the goals order and the routes of different boxes
+// depend only on the matching and are calculated in parallel
+void BoardGraphs::schedule(TaskGraph & tasks, const BoardState & state) {
+    const auto distances = tasks.add("goal distances", [this, &state]{
+        calculate_goals_distances(state); });
+
+    const auto matching = tasks.add("bipartite matching", [this, &state]{
+        bipartite_matching(state); }, { distances });
+
+    tasks.add("goals order", [this, &state]{ calculate_goals_order(state); }, { matching });
+    for (size_t i = 0; i < _box_count; ++i) {
+        tasks.add("box routes", [this, i]{ calculate_route(i); }, { matching });
+    }
+}
+
+bool BoardGraphs::build_graphs(const BoardState & state) {
     _count     = state.tile_count();
     _box_count = state.box_count();
-    _all_moves.resize(_count);
+    _goals_order.clear();
+    _goals_order_bits.clear();
 
-    DGraph reverse_pushes;
-    reverse_pushes.resize(_count);
+    // the graphs are constructed as adjacency lists and then compressed
+    SparseGraph<index_t, DIR_COUNT, false> all_moves;
+    SparseGraph<index_t, DIR_COUNT, true>  all_reverse_pushes;
+    all_moves.resize(_count);
+    all_reverse_pushes.resize(_count);
 
     for (index_t i = 0; i < _count; i++) {
         if (state.is_wall(i)) { continue; }
@@ -36,20 +70,24 @@ bool BoardGraphs::initialize(const BoardState & state) {
 
         // insert reversed edges
         if (is_passable_u && is_passable_d) {
-            reverse_pushes.insert_edge(ind_u, i);
-            reverse_pushes.insert_edge(ind_d, i);
+            all_reverse_pushes.insert_edge(ind_u, i);
+            all_reverse_pushes.insert_edge(ind_d, i);
         }
         if (is_passable_l && is_passable_r) {
-            reverse_pushes.insert_edge(ind_l, i);
-            reverse_pushes.insert_edge(ind_r, i);
+            all_reverse_pushes.insert_edge(ind_l, i);
+            all_reverse_pushes.insert_edge(ind_r, i);
         }
 
-        if (is_passable_u) { _all_moves.insert_edge(i, ind_u); }
-        if (is_passable_l) { _all_moves.insert_edge(i, ind_l); }
-        if (is_passable_r) { _all_moves.insert_edge(i, ind_r); }
-        if (is_passable_d) { _all_moves.insert_edge(i, ind_d); }
+        if (is_passable_u) { all_moves.insert_edge(i, ind_u); }
+        if (is_passable_l) { all_moves.insert_edge(i, ind_l); }
+        if (is_passable_r) { all_moves.insert_edge(i, ind_r); }
+        if (is_passable_d) { all_moves.insert_edge(i, ind_d); }
     }
 
+    _all_moves      = UGraph{ all_moves };
+    _reverse_pushes = DGraph{ all_reverse_pushes };
+    _boxes_routes.resize(_box_count);
+
     /* reverse_pushes.print(); */
     /* cout << "REVERSE PUSHES:\n" << endl; */
     /* auto nodes = reverse_pushes.nodes(); */
@@ -59,24 +97,41 @@ bool BoardGraphs::initialize(const BoardState & state) {
     /* cout << string_join(pushes, ", ") << endl; */
     /* state.print(pushes); */
 
-    bipartite_matching(state, reverse_pushes);
-    calculate_goals_distances(state, reverse_pushes);
-    calculate_goals_order(state, reverse_pushes);
-    calculate_routes(reverse_pushes);
-    narrow_moves(state.box_indexes());
-
     return true;
 }
 
-void BoardGraphs::bipartite_matching(const BoardState & state, const DGraph & reverse_pushes) {
-    // collect all achievable goals for each box
-    _boxes_goals.resize(_box_count, {});
-    for (const auto goali: state.goal_indexes()) {
-        const auto passable_boxes = reverse_pushes.test_passability(goali, state.box_indexes());
+void BoardGraphs::complete(const BoardState & state) {
+    for (const auto gi: _goals_order) {
+        _goals_order_bits.push_back(state.goal_bit(state.goal_index(gi)));
+    }
 
-        for (size_t i = 0; i < passable_boxes.size(); ++i) {
-            if (passable_boxes[i]) {
-                _boxes_goals[i].push_back(goali);
+    _boxes_distances.assign(_box_count * _count, static_cast<uint16_t>(UNREACHABLE));
+    for (size_t i = 0; i < _box_count; ++i) {
+        for (const auto goali: _boxes_goals[i]) {
+            const auto gi = static_cast<size_t>(distance(begin(state.goal_indexes()),
+                    find(begin(state.goal_indexes()), end(state.goal_indexes()), goali)));
+            for (size_t ind = 0; ind < _count; ++ind) {
+                auto & d = _boxes_distances[i * _count + ind];
+                d = min(d, _goals_distances[gi * _count + ind]);
+            }
+        }
+    }
+
+    narrow_moves(state.box_indexes());
+
+    // the routes keep their own copies of the graph
+    _reverse_pushes = DGraph{};
+}
+
+void BoardGraphs::bipartite_matching(const BoardState & state) {
+    // collect all achievable goals for each box, the goal is achievable
+    // if it has the finite distance to the box
+    for (auto & bg: _boxes_goals) { bg.clear(); }
+    _boxes_goals.resize(_box_count);
+    for (size_t gi = 0; gi < _box_count; ++gi) {
+        for (size_t i = 0; i < _box_count; ++i) {
+            if (distance_to_goal(gi, state.box_index(i)) != UNREACHABLE) {
+                _boxes_goals[i].push_back(state.goal_index(gi));
             }
         }
     }
@@ -101,110 +156,123 @@ void BoardGraphs::bipartite_matching(const BoardState & state, const DGraph & re
     }
 }
 
-void BoardGraphs::calculate_goals_distances(const BoardState & state,
-                                            const DGraph & reverse_pushes) {
-    _goals_distances.resize(_box_count);
-    auto nodes = reverse_pushes.nodes_with_distances();
+void BoardGraphs::calculate_goals_distances(const BoardState & state) {
+    // all goals are processed at once, one bit lane per goal
+    _goals_distances = multi_source_distances(_reverse_pushes, state.goal_indexes());
+}
 
-    for (size_t i = 0; i < _box_count; ++i) {
-        std::for_each(nodes.begin(state.goal_index(i)), nodes.end(), [](auto){});
-        _goals_distances[i] = nodes.distances();
+vector<size_t> BoardGraphs::distances_to_goal(const size_t goali) const {
+    vector<size_t> result(_count, numeric_limits<size_t>::max());
+    for (size_t i = 0; i < _count; ++i) {
+        if (distance_to_goal(goali, i) != UNREACHABLE) {
+            result[i] = distance_to_goal(goali, i);
+        }
     }
+    return result;
 }
 
-void BoardGraphs::calculate_goals_order(const BoardState & state,
-                                        const DGraph & reverse_pushes) {
-    vector<pair<size_t, index_t>> unordered_goals;
+void BoardGraphs::calculate_goals_order(const BoardState & state) {
+    // The goal may be filled next if blocking its tile doesn't cut off any box
+    // from any other unfilled goal the box can be matched with. The graph isn't
+    // copied: the filled goals and the candidate are masked out during the search,
+    // and the reachability of all unfilled goals is calculated at once, lane i
+    // of the reachability word corresponds to i-th goal.
+    using lanes_t = MultiSourceBFS<index_t>::lanes_t;
+    static_assert(MAX_BOX_COUNT <= MultiSourceBFS<index_t>::LANE_COUNT);
+
+    vector<lanes_t> boxes_goal_lanes(_box_count, 0u);
     for (size_t i = 0; i < _box_count; ++i) {
-        unordered_goals.push_back({ i, state.goal_index(i) });
-    };
-    DGraph base_rpushes{ reverse_pushes };
+        for (const auto goali: _boxes_goals[i]) {
+            boxes_goal_lanes[i] |= state.goal_bit(goali);
+        }
+    }
 
-    while (!unordered_goals.empty()) {
-        for (const auto [gi, goali]: unordered_goals) {
-            DGraph trpushes{ base_rpushes };
-            trpushes.remove_node(goali);
+    flags blocked;
+    lanes_t unordered = 0u;
+    for (size_t gi = 0; gi < _box_count; ++gi) { unordered |= lanes_t{ 1u } << gi; }
 
-            /* bool at_least_one_passable = false; */
-            bool all_passable = true;
+    MultiSourceBFS<index_t> bfs;
+    const auto is_blocked = [&blocked](index_t ind){ return blocked[ind]; };
+
+    while (unordered != 0u) {
+        size_t found = _box_count;
+
+        for (size_t gi = 0; gi < _box_count && found == _box_count; ++gi) {
+            if ((unordered & (lanes_t{ 1u } << gi)) == 0u) { continue; }
+
+            const index_t goali = state.goal_index(gi);
+            const lanes_t others = unordered & ~(lanes_t{ 1u } << gi);
+
+            blocked[goali] = true;
+            const auto & reached = bfs.reachability(_reverse_pushes, state.goal_indexes(), is_blocked);
+            blocked[goali] = false;
 
             // for each remaining goal, check if there are any boxes,
-            // that have become unpassable for it (after removing the node)
-            for (const auto [ignored, chgi]: unordered_goals) {
-                if (chgi == goali) { continue; }
-
-                const auto passbits = trpushes.test_passability(chgi, state.box_indexes());
-                /* cout << "goali:" << goali << " " */
-                /*      << "chgi:" << chgi << " " */
-                /*      << string_join(state.box_indexes()) << " " */
-                /*      << string_join(passbits, "") << endl; */
-
-                for (size_t i = 0; i < _box_count; ++i) {
-                    if (binary_search(begin(_boxes_goals[i]), end(_boxes_goals[i]), chgi)) {
-                        // if the box is already in the goali room, it's passable
-                        if ((!passbits[i]) && state.box_index(i) != goali) {
-                            // if the box is in the room with ordered goal, it's passable
-                            if (find_if(begin(_goals_order), end(_goals_order),
-                                     [&state, i=i](size_t ind){
-                                        return state.goal_index(ind) == state.box_index(i);
-                                     }) == end(_goals_order)) {
-                                /* cout << goali << " " << state.box_index(i) << endl; */
-                                all_passable = false;
-                            }
-                        }
-                    }
-                }
-            }
+            // that have become unpassable for it (after blocking the goal)
+            bool all_passable = true;
+            for (size_t i = 0; i < _box_count && all_passable; ++i) {
+                const index_t boxi = state.box_index(i);
+
+                // if the box is already in the goali room or in the room
+                // with ordered goal, it's passable
+                if (boxi == goali || blocked[boxi]) { continue; }
 
-            if (all_passable) {
-                /* cout << "FOUND! " << goali<< endl; */
-                _goals_order.push_back(gi);
-                unordered_goals.erase(remove(begin(unordered_goals), end(unordered_goals),
-                                             make_pair(gi, goali)),
-                                      end(unordered_goals));
-                base_rpushes.remove_node(goali);
-                break;
+                all_passable = (boxes_goal_lanes[i] & others & ~reached[boxi]) == 0u;
             }
+
+            if (all_passable) { found = gi; }
+        }
+
+        // there is no goal which doesn't block others, so the order doesn't matter
+        if (found == _box_count) {
+            found = static_cast<size_t>(__builtin_ctzll(unordered));
         }
+
+        _goals_order.push_back(found);
+        unordered &= ~(lanes_t{ 1u } << found);
+        blocked[state.goal_index(found)] = true;
     }
 }
 
-// calculates the routes of the boxes (all possible pushes for every box)
-// The routes depend on bipartite matching results and results of minimum matching algorithm
-void BoardGraphs::calculate_routes(const DGraph & reverse_pushes) {
-    _boxes_routes.resize(_box_count, reverse_pushes);
+// calculates the route of the box (all possible pushes for the box)
+// The route depends on bipartite matching results and results of minimum matching algorithm
+void BoardGraphs::calculate_route(const size_t boxi) {
+    // the routes may be calculated in parallel, so they don't share the scratch buffers
+    GraphTraversal<index_t> traversal;
 
-    for (size_t i = 0; i < _box_count; ++i) {
-        _boxes_routes[i].remove_impassable(_boxes_goals[i]);
-        _boxes_routes[i].transpose();
-    }
+    _boxes_routes[boxi] = _reverse_pushes;
+    _boxes_routes[boxi].remove_impassable(_boxes_goals[boxi], traversal);
+    _boxes_routes[boxi].transpose();
 }
 
 size_t BoardGraphs::ordered_boxes_on_goals(const BoardState & state) const {
+    const goalmask_t occupied = state.goals_occupied();
+
     size_t result = 0u;
-    for (const auto i: _goals_order) {
-        index_t goali = state.goal_index(i);
-        if (state.is_box(goali)) { result++; continue; }
-        else { break; }
+    while (result < _goals_order_bits.size() && (occupied & _goals_order_bits[result])) {
+        result++;
     }
     return result;
 }
 
 pair<size_t, size_t> BoardGraphs::push_distances(const BoardState & state,
                                                  size_t boxi, const PushInfo & pi) const {
-    for (const auto i: _goals_order) {
+    const goalmask_t occupied = state.goals_occupied();
+
+    for (size_t oi = 0; oi < _goals_order.size(); ++oi) {
+        const size_t i = _goals_order[oi];
         index_t goali = state.goal_index(i);
 
         // if there is already a box on the goal
-        if (state.is_box(goali)) { continue; }
+        if (occupied & _goals_order_bits[oi]) { continue; }
 
         // if box can't move to that goal
         if (!binary_search(begin(_boxes_goals[boxi]), end(_boxes_goals[boxi]), goali)) { continue; }
 
         // we found the goal with the highest priority for considered box
         // return distances before and after the pushing
-        const size_t dist_from = _goals_distances[i][pi.from()];
-        const size_t dist_to   = _goals_distances[i][pi.to()];
+        const size_t dist_from = distance_to_goal(i, pi.from());
+        const size_t dist_to   = distance_to_goal(i, pi.to());
         return make_pair(dist_from, dist_to);
     }
 
@@ -212,16 +280,23 @@ pair<size_t, size_t> BoardGraphs::push_distances(const BoardState & state,
     return {};
 }
 
-index_t BoardGraphs::min_move_index(index_t player) const {
-    auto nodes = _boxdep_moves.nodes();
+index_t BoardGraphs::min_move_index(index_t player) {
+    _traversal.bfs(_boxdep_moves, player);
+
+    return *min_element(begin(_traversal), end(_traversal));
+}
 
-    // we don't use min_element because the graph iterator has the input_iterator category,
-    // so we can't read a value twice
-    index_t min = MAX_TILE_COUNT;
-    for_each (nodes.begin(player), nodes.end(),
-              [&min](const auto ind){ if (min > ind) { min = ind; } });
+void BoardGraphs::min_move_indexes(index_t player, const vector<vector<index_t>> & permutations,
+                                   vector<index_t> & result) {
+    _traversal.bfs(_boxdep_moves, player);
 
-    return min;
+    result.assign(permutations.size() + 1u, numeric_limits<index_t>::max());
+    for (const auto ind: _traversal) {
+        result[0] = min(result[0], ind);
+        for (size_t i = 0; i < permutations.size(); ++i) {
+            result[i + 1u] = min(result[i + 1u], permutations[i][ind]);
+        }
+    }
 }
 
 void BoardGraphs::narrow_moves(const std::vector<index_t> & indexes) {
@@ -231,12 +306,10 @@ void BoardGraphs::narrow_moves(const std::vector<index_t> & indexes) {
     }
 }
 
-flags BoardGraphs::narrowed_moves_bitset(const index_t from) const {
+flags BoardGraphs::narrowed_moves_bitset(const index_t from) {
     bitset<MAX_TILE_COUNT> result;
 
-    auto nodes = _boxdep_moves.nodes();
-    for_each(nodes.begin(from), nodes.end(),
-             [&result](auto ind){ result[ind] = true; });
+    _traversal.bfs(_boxdep_moves, from, [&result](auto ind){ result[ind] = true; });
 
     return result;
 }
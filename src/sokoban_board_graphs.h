@@ -4,53 +4,78 @@
 #include "sokoban_common.h"
 #include "sokoban_pushinfo.h"
 #include "sparse_graph.h"
+#include "csr_graph.h"
+#include "graph_traversal.h"
+#include "multi_source_bfs.h"
+#include "task_graph.h"
 
 #include <vector>
+#include <cstdint>
 
 namespace Sokoban
 {
 class BoardState;
 
 class BoardGraphs {
-    using UGraph = SparseGraph<index_t, DIR_COUNT, false>;
-    using DGraph = SparseGraph<index_t, DIR_COUNT, true>;
+    using UGraph = CSRGraph<index_t, DIR_COUNT, false>;
+    using DGraph = CSRGraph<index_t, DIR_COUNT, true>;
 
     UGraph _all_moves;
     UGraph _boxdep_moves;
+    DGraph _reverse_pushes; // is used only during the initialization
 
     std::vector<std::vector<index_t>> _boxes_goals;
-    std::vector<std::vector<size_t>>  _goals_distances;
+    std::vector<std::uint16_t>        _goals_distances; // [goal][tile]
+    std::vector<std::uint16_t>        _boxes_distances; // [box][tile], to the nearest goal of the box
     std::vector<DGraph>               _boxes_routes;
     std::vector<size_t>               _goals_order;
+    std::vector<goalmask_t>           _goals_order_bits;
 
     size_t _count, _box_count;
 
+    // scratch buffers shared by all traversals of the graphs
+    GraphTraversal<index_t> _traversal;
+
 public:
+    static constexpr size_t UNREACHABLE = std::numeric_limits<std::uint16_t>::max();
+
     BoardGraphs() = default;
     bool initialize(const BoardState & state);
 
-    void bipartite_matching(const BoardState & state, const DGraph & reverse_pushes);
+    // initialization by stages: build_graphs(), then the tasks added by schedule(),
+    // then complete()
+    bool build_graphs(const BoardState & state);
+    void schedule(TaskGraph & tasks, const BoardState & state);
+    void complete(const BoardState & state);
+
+    void bipartite_matching(const BoardState & state);
 
-    void calculate_routes(const DGraph & reverse_pushes);
-    void calculate_goals_distances(const BoardState & state,
-                                   const DGraph & reverse_pushes);
-    void calculate_goals_order(const BoardState & state,
-                               const DGraph & reverse_pushes);
+    void calculate_route(size_t boxi);
+    void calculate_goals_distances(const BoardState & state);
+    void calculate_goals_order(const BoardState & state);
 
     const auto & route(const size_t ind) const { return _boxes_routes[ind]; }
     const auto & goals(const size_t ind) const { return _boxes_goals[ind]; }
-    const auto & distances_to_goal(const size_t goali) const { return _goals_distances[goali]; }
-    /* const auto & distance_to_goal_from(size_t goali, size_t ind) const { */
-    /*     return _goals_distances[goali][ind]; } */
+    std::vector<size_t> distances_to_goal(const size_t goali) const;
+    size_t distance_to_goal(const size_t goali, const size_t ind) const {
+        return _goals_distances[goali * _count + ind]; }
+    // the lower bound of the number of pushes of the box from the tile to any of its goals
+    size_t box_distance(const size_t boxi, const size_t ind) const {
+        return _boxes_distances[boxi * _count + ind]; }
     const auto & goals_order() const { return _goals_order; }
     size_t ordered_boxes_on_goals(const BoardState & state) const;
     std::pair<size_t, size_t> push_distances(const BoardState & state,
                                              size_t boxi, const PushInfo & pi) const;
 
-    index_t min_move_index(index_t player) const;
+    // the traversals use the scratch buffers of the graphs, so they aren't const
+    index_t min_move_index(index_t player);
+    // the least index of the area of the player, then for every permutation
+    // the least of the permuted indexes of the area
+    void min_move_indexes(index_t player, const std::vector<std::vector<index_t>> & permutations,
+                          std::vector<index_t> & result);
 
     void narrow_moves(const std::vector<index_t> & indexes);
-    flags narrowed_moves_bitset(const index_t from) const;
+    flags narrowed_moves_bitset(const index_t from);
 };
 }
 
@@ -2,16 +2,29 @@
 #include "sokoban_boxstate.h"
 #include "sokoban_pushinfo.h"
 #include "sokoban_formatter.h"
+#include "sokoban_level_symmetry.h"
 
 #include <algorithm>
 #include <iostream>
 #include <iomanip>
 #include <iterator>
+#include <numeric>
 
 using namespace Sokoban;
 using namespace std;
 
 bool BoardState::initialize(std::vector<Tile> && tiles, size_t width, size_t height) {
+    // the state of the previous level
+    for (const auto gi: _goals) { _goal_bit[gi] = 0u; }
+    _goals.clear();
+    _boxes.clear();
+    _is_wall.reset();
+    _is_goal.reset();
+    _is_box.reset();
+    _all_goals_mask = _goals_occupied = 0u;
+    _boxes_on_goals = 0u;
+    _symmetries.clear();
+
     _tiles  = move(tiles);
     _width  = width;
     _height = height;
@@ -25,7 +38,53 @@ bool BoardState::initialize(std::vector<Tile> && tiles, size_t width, size_t hei
         if (tile_is_box(tile))    { _boxes.push_back(i); _is_box[i] = true; }
     }
 
-    return _boxes.size() == _goals.size();
+    if (_goals.size() > MAX_BOX_COUNT) { return false; }
+    for (size_t gi = 0; gi < _goals.size(); ++gi) {
+        _goal_bit[_goals[gi]] = goalmask_t{ 1u } << gi;
+        _all_goals_mask |= _goal_bit[_goals[gi]];
+    }
+    for (const auto bi: _boxes) { occupy_goal(bi); }
+
+    if (_boxes.size() != _goals.size()) { return false; }
+    detect_symmetries();
+    return true;
+}
+
+// The rotations and reflections of the bounding box of the area reachable
+// by the player (boxes don't stop it), which keep the area and its goals.
+// The boxes are a part of the state, so they don't matter.
+void BoardState::detect_symmetries() {
+    const auto reached = reachable_area(_tiles, _width, _height);
+    // no player (e.g. an empty level), nothing to keep
+    if (find(begin(reached), end(reached), true) == end(reached)) { return; }
+
+    size_t left = _width, right = 0u, top = _height, bottom = 0u;
+    for (index_t i = 0; i < _tiles.size(); ++i) {
+        if (!reached[i]) { continue; }
+        left = min(left, i % _width); right  = max(right, i % _width);
+        top  = min(top, i / _width);  bottom = max(bottom, i / _width);
+    }
+
+    const size_t w = right - left + 1u, h = bottom - top + 1u;
+    for (unsigned symmetry = 1u; symmetry < 8u; ++symmetry) {
+        const RectangleSymmetry transform(w, h, symmetry);
+        if (transform.transposed() && w != h) { continue; }
+
+        vector<index_t> permutation(_tiles.size());
+        iota(begin(permutation), end(permutation), index_t{ 0 });
+
+        bool symmetric = true;
+        for (index_t i = 0; i < _tiles.size() && symmetric; ++i) {
+            if (!reached[i]) { continue; }
+
+            const auto [x, y] = transform.forward(i % _width - left, i / _width - top);
+            const size_t j = (y + top) * _width + x + left;
+            symmetric = reached[j] && _is_goal[i] == _is_goal[j];
+            permutation[i] = static_cast<index_t>(j);
+        }
+
+        if (symmetric) { _symmetries.push_back(move(permutation)); }
+    }
 }
 
 BoxState BoardState::current_boxstate() const {
@@ -34,6 +93,7 @@ BoxState BoardState::current_boxstate() const {
     bs.player_index = _player;
     copy(begin(_boxes), end(_boxes), begin(bs.box_indexes));
     bs.box_bits = _is_box;
+    bs.goal_bits = _goals_occupied;
 
     return bs;
 }
@@ -42,11 +102,16 @@ void BoardState::set_boxstate(const BoxState & bs) {
     copy_n(begin(bs.box_indexes), _boxes.size(), begin(_boxes));
     _is_box = bs.box_bits;
     _player = bs.player_index;
+
+    _goals_occupied = bs.goal_bits;
+    _boxes_on_goals = bitset<MAX_BOX_COUNT>(_goals_occupied).count();
 }
 
 void BoardState::apply_push(const PushInfo & pi) {
     _is_box[pi.from()] = false;
     _is_box[pi.to()] = true;
+    release_goal(pi.from());
+    occupy_goal(pi.to());
     replace(begin(_boxes), end(_boxes), pi.from(), pi.to());
 
     _player = pi.from();
@@ -92,12 +157,3 @@ void BoardState::print(const vector<index_t> & marked) const {
     print_level_string(level);
 }
 
-size_t BoardState::boxes_on_goals() const {
-    size_t result = 0u;
-    for (const auto gi: _goals) {
-        if (_is_box[gi]) { result++; }
-    }
-
-    return result;
-}
-
@@ -3,6 +3,7 @@
 
 #include "sokoban_common.h"
 #include <vector>
+#include <array>
 
 namespace Sokoban
 {
@@ -17,6 +18,26 @@ class BoardState {
     std::vector<index_t> _goals, _boxes;
     flags _is_wall, _is_goal, _is_box;
 
+    // goal occupancy is tracked incrementally, so goal tests don't need
+    // to compare the whole bitsets
+    std::array<goalmask_t, MAX_TILE_COUNT> _goal_bit{};
+    goalmask_t _all_goals_mask = 0u;
+    goalmask_t _goals_occupied = 0u;
+    size_t     _boxes_on_goals = 0u;
+
+    void occupy_goal(const index_t index) {
+        if (_goal_bit[index] != 0u) { _goals_occupied |= _goal_bit[index]; _boxes_on_goals++; }
+    }
+    void release_goal(const index_t index) {
+        if (_goal_bit[index] != 0u) { _goals_occupied &= ~_goal_bit[index]; _boxes_on_goals--; }
+    }
+
+    // the permutations of the tiles (without the identity), which map the area
+    // of the player with its walls and goals onto itself
+    std::vector<std::vector<index_t>> _symmetries;
+
+    void detect_symmetries();
+
     std::string level_as_string(bool draw_boxes) const;
     void print_level_string(const std::string & level) const;
 
@@ -36,27 +57,32 @@ public:
     void set_boxstate(const BoxState & bs);
     void apply_push(const PushInfo & pi);
 
-    bool is_complete() const  { return _is_box == _is_goal; }
+    bool is_complete() const  { return _goals_occupied == _all_goals_mask; }
 
     size_t tile_count() const { return _tiles.size(); }
     size_t box_count()  const { return _boxes.size(); }
     size_t width()  const     { return _width;  }
     size_t height() const     { return _height; }
 
+    const std::vector<std::vector<index_t>> & symmetries() const { return _symmetries; }
+
     index_t player() const                            { return _player; }
     const std::vector<index_t> & box_indexes()  const { return _boxes; }
     const std::vector<index_t> & goal_indexes() const { return _goals; }
     index_t box_index(size_t index)  const { return _boxes[index]; }
     index_t goal_index(size_t index) const { return _goals[index]; }
 
-    void remove_bitset_box(const index_t index)  { _is_box[index] = false; }
-    void recover_bitset_box(const index_t index) { _is_box[index] = true;  }
+    void remove_bitset_box(const index_t index)  { _is_box[index] = false; release_goal(index); }
+    void recover_bitset_box(const index_t index) { _is_box[index] = true;  occupy_goal(index);  }
 
     bool is_wall(const size_t index) const     { return _is_wall[index]; }
     bool is_goal(const size_t index) const     { return _is_goal[index]; }
     bool is_box (const size_t index) const     { return _is_box[index];  }
 
-    size_t boxes_on_goals() const;
+    // bit i is set when there is a box on the goal_index(i) tile
+    goalmask_t goals_occupied() const  { return _goals_occupied; }
+    goalmask_t goal_bit(const size_t index) const { return _goal_bit[index]; }
+    size_t boxes_on_goals() const      { return _boxes_on_goals; }
 };
 }
 
@@ -3,6 +3,7 @@
 
 #include <cstddef>
 #include <bitset>
+#include <limits>
 
 namespace Sokoban
 {
@@ -45,6 +46,10 @@ static constexpr size_t MAX_TILE_COUNT = 500;
 static constexpr size_t MAX_BOX_COUNT = 15;
 
 using flags = std::bitset<MAX_TILE_COUNT>;
+
+// bitmask over goal numbers, bit i is set when there is a box on i-th goal
+using goalmask_t = unsigned;
+static_assert(MAX_BOX_COUNT <= std::numeric_limits<goalmask_t>::digits);
 }
 
 #endif
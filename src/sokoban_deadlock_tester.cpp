@@ -1,6 +1,8 @@
 #include "sokoban_deadlock_tester.h"
 #include "sokoban_board_state.h"
 #include "deadlocks.h"
+#include "deadlock_database.h"
+#include "task_graph.h"
 
 #include <cassert>
 #include <iostream>
@@ -28,32 +30,30 @@ optional<index_t> DeadlockTester::symmetric_index(size_t ind, const pair<int, in
 }
 
 bool DeadlockTester::test_landscape(const BoardState & state,
-                const DeadlockInfo & dlinfo, const pair<bool, bool> & refl, index_t ind) const
+                const DeadlockPatternView & dlinfo, const pair<bool, bool> & refl, index_t ind) const
 {
     if (state.is_wall(ind)) return false;
 
-    auto get_index = [&](const Point & p){
+    auto get_index = [&](const PackedPoint & p){
         return symmetric_index(ind, { p.y, p.x }, refl);
     };
 
-    const auto & [wallpoints, spacepoints, boxpoints, goalpoints, indep] = dlinfo;
-
-    for (const auto & wp: wallpoints) {
+    for (const auto & wp: dlinfo.walls()) {
         const auto wi = get_index(wp);
         if (!wi.has_value())    { return false; }
         if (!state.is_wall(wi.value())) { return false; }
     }
 
-    for (const auto & sp: spacepoints) {
+    for (const auto & sp: dlinfo.spaces()) {
         const auto si = get_index(sp);
         if (!si.has_value())   { return false; }
         if ( state.is_wall(si.value())) { return false; }
     }
 
-    for (const auto & gione: goalpoints) {
+    for (size_t gsi = 0; gsi < dlinfo.goalset_count(); ++gsi) {
         bool all_of_indexes_is_goals = true;
 
-        for (const auto gp: gione) {
+        for (const auto gp: dlinfo.goalset(gsi)) {
             const auto gi = get_index(gp);
             if (!gi.has_value()) return false;
             all_of_indexes_is_goals &= state.is_goal(gi.value());
@@ -67,8 +67,32 @@ bool DeadlockTester::test_landscape(const BoardState & state,
 bool DeadlockTester::initialize(const BoardState & state) {
     _width  = state.width();
     _height = state.height();
+    for (auto & checks: _checks) { checks.clear(); }
+    _checks.resize(state.tile_count());
+    _patterns = active_deadlocks();
+
+    initialize_tiles(state, 0u, static_cast<index_t>(state.tile_count()));
+    return true;
+}
+
+void DeadlockTester::schedule(TaskGraph & tasks, const BoardState & state) {
+    constexpr size_t TILES_PER_TASK = 64u;
+
+    _width  = state.width();
+    _height = state.height();
+    for (auto & checks: _checks) { checks.clear(); }
     _checks.resize(state.tile_count());
+    _patterns = active_deadlocks();
+
+    for (size_t first = 0; first < state.tile_count(); first += TILES_PER_TASK) {
+        const auto last = min(first + TILES_PER_TASK, state.tile_count());
+        tasks.add("deadlock patterns", [this, &state, first, last]{
+            initialize_tiles(state, static_cast<index_t>(first), static_cast<index_t>(last));
+        });
+    }
+}
 
+void DeadlockTester::initialize_tiles(const BoardState & state, index_t first, index_t last) {
     // captures the reference to a member of another class!
     auto check_all = [&state](const vector<index_t> & inds) {
         return all_of(begin(inds), end(inds),
@@ -79,29 +103,44 @@ bool DeadlockTester::initialize(const BoardState & state) {
         {false, false}, {true, false}, {false, true}, {true, true}
     }};
 
-    for (index_t ind = 0; ind < state.tile_count(); ind++) {
+    const auto & index = _patterns->index();
+    const auto & cells = index.cells();
+    vector<size_t> candidates;
+
+    for (index_t ind = first; ind < last; ind++) {
         if (state.is_wall(ind)) { continue; }
 
         for (const auto & refl: reflections) {
-            for (const auto & dlset: generated_deadlocks) {
-                for (const auto & dlinfo: dlset) {
-                    if (test_landscape(state, dlinfo, refl, ind)) {
-                        vector<index_t> boxinds;
-
-                        transform(begin(dlinfo.boxes), end(dlinfo.boxes),
-                                  back_inserter(boxinds), [&](auto p) {
-                                        const auto symi = symmetric_index(ind, { p.y, p.x }, refl);
-                                        assert(symi.has_value());
-                                        return symi.value();
-                                  });
-
-                        _checks[ind].push_back(bind(check_all, boxinds));
-                    }
+            // the signature of the reflected neighbourhood of the tile
+            DeadlockIndex::signature_t walls = 0u, inside = 0u;
+            for (size_t ci = 0; ci < cells.size(); ++ci) {
+                const auto symi = symmetric_index(ind, { cells[ci].y, cells[ci].x }, refl);
+                if (!symi.has_value() || symi.value() >= state.tile_count()) { continue; }
+
+                const auto bit = DeadlockIndex::signature_t{ 1u } << ci;
+                inside |= bit;
+                if (state.is_wall(symi.value())) { walls |= bit; }
+            }
+
+            index.candidates(walls, inside, candidates);
+            for (const auto pi: candidates) {
+                const auto dlinfo = _patterns->pattern(pi);
+                if (test_landscape(state, dlinfo, refl, ind)) {
+                    vector<index_t> boxinds;
+
+                    const auto boxes = dlinfo.boxes();
+                    transform(begin(boxes), end(boxes),
+                              back_inserter(boxinds), [&](auto p) {
+                                    const auto symi = symmetric_index(ind, { p.y, p.x }, refl);
+                                    assert(symi.has_value());
+                                    return symi.value();
+                              });
+
+                    _checks[ind].push_back(bind(check_all, boxinds));
                 }
             }
         }
     }
-    return true;
 }
 
 bool DeadlockTester::test_for_index(index_t ind) const {
@@ -5,26 +5,36 @@
 
 #include <vector>
 #include <functional>
+#include <optional>
+#include <memory>
+
+class TaskGraph;
 
 namespace Sokoban
 {
 class BoardState;
-class DeadlockInfo;
+class DeadlockDatabase;
+class DeadlockPatternView;
 
 class DeadlockTester {
     std::vector<std::vector<std::function<bool()>>> _checks;
+    std::shared_ptr<const DeadlockDatabase> _patterns;
     size_t _width, _height;
 
     std::optional<index_t> symmetric_index(size_t ind,
                         const std::pair<int, int> & diff,
                         const std::pair<bool, bool> & refl) const;
-    bool test_landscape(const BoardState & state, const DeadlockInfo & dlinfo,
+    bool test_landscape(const BoardState & state, const DeadlockPatternView & dlinfo,
                         const std::pair<bool, bool> & refl, index_t ind) const;
 
 public:
     DeadlockTester() = default;
 
     bool initialize(const BoardState & state);
+
+    // adds the tasks which perform the initialization, tiles are processed in parallel
+    void schedule(TaskGraph & tasks, const BoardState & state);
+    void initialize_tiles(const BoardState & state, index_t first, index_t last);
     bool test_for_index(index_t ind) const;
 };
 }
@@ -0,0 +1,301 @@
+#include "sokoban_external_search.h"
+#include "sokoban_board.h"
+#include "sokoban_boxstate.h"
+
+#include <fstream>
+#include <algorithm>
+#include <queue>
+#include <memory>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+
+#include <sys/stat.h>
+
+using namespace Sokoban;
+using namespace std;
+
+namespace
+{
+constexpr size_t BUFFER_SIZE = 1u << 20;
+
+// the sequential stream of the fixed-size records
+class RecordWriter {
+    vector<char> _buffer;
+    ofstream _fs;
+    size_t _record_bytes;
+    uint64_t _count = 0u;
+
+public:
+    RecordWriter(const string & path, size_t record_size)
+        : _buffer(BUFFER_SIZE), _record_bytes{ record_size * sizeof(uint16_t) } {
+        _fs.rdbuf()->pubsetbuf(_buffer.data(), static_cast<streamsize>(_buffer.size()));
+        _fs.open(path, ios_base::out | ios_base::binary | ios_base::trunc);
+    }
+
+    void put(const uint16_t * record) {
+        _fs.write(reinterpret_cast<const char *>(record), static_cast<streamsize>(_record_bytes));
+        ++_count;
+    }
+
+    bool finish() {
+        _fs.close();
+        return static_cast<bool>(_fs);
+    }
+
+    uint64_t count() const { return _count; }
+};
+
+class RecordReader {
+    vector<char> _buffer;
+    ifstream _fs;
+    vector<uint16_t> _record;
+    bool _valid = false;
+    bool _failed = false;
+
+public:
+    RecordReader(const string & path, size_t record_size) : _buffer(BUFFER_SIZE), _record(record_size) {
+        _fs.rdbuf()->pubsetbuf(_buffer.data(), static_cast<streamsize>(_buffer.size()));
+        _fs.open(path, ios_base::in | ios_base::binary);
+        next();
+    }
+
+    // the current record is valid until the next call
+    bool next() {
+        _valid = static_cast<bool>(_fs.read(reinterpret_cast<char *>(_record.data()),
+                                            static_cast<streamsize>(_record.size() * sizeof(uint16_t))));
+        // only the clean end of the file ends the records, a partial record is an error
+        if (!_valid) { _failed = !_fs.eof() || _fs.gcount() != 0; }
+        return _valid;
+    }
+
+    bool valid() const { return _valid; }
+    // the file can't be opened or read, the records are incomplete
+    bool failed() const { return _failed; }
+    const uint16_t * record() const { return _record.data(); }
+};
+
+int compare(const uint16_t * l, const uint16_t * r, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        if (l[i] != r[i]) { return l[i] < r[i] ? -1 : 1; }
+    }
+    return 0;
+}
+}
+
+ExternalSearch::ExternalSearch(Board & board, const Options & options)
+    : _board{ board }, _options{ options }, _box_count{ board.box_count() },
+      _key_size{ _box_count + 1 }, _record_size{ 2 * _box_count + 1 } {
+}
+
+ExternalSearch::~ExternalSearch() {
+    for (const auto & file: _files) { remove(file.c_str()); }
+}
+
+string ExternalSearch::path(const string & name) {
+    string result = _options.directory + "/sokoban-" + name + ".bin";
+    if (find(_files.begin(), _files.end(), result) == _files.end()) { _files.push_back(result); }
+    return result;
+}
+
+void ExternalSearch::to_record(const BoxState & bs, uint16_t * record) const {
+    for (size_t i = 0; i < _box_count; ++i) {
+        record[i] = bs.box_indexes[i];
+        record[_key_size + i] = bs.box_indexes[i];
+    }
+    sort(record, record + _box_count);
+    record[_box_count] = bs.player_index;
+}
+
+BoxState ExternalSearch::from_record(const uint16_t * record) const {
+    array<index_t, MAX_BOX_COUNT> boxes{};
+    copy(record + _key_size, record + _record_size, boxes.begin());
+    return _board.make_state(boxes.data(), record[_box_count]);
+}
+
+string ExternalSearch::write_run(vector<uint16_t> & buffer, size_t run_index) {
+    const size_t count = buffer.size() / _record_size;
+    vector<uint32_t> order(count);
+    for (size_t i = 0; i < count; ++i) { order[i] = static_cast<uint32_t>(i); }
+
+    const uint16_t * data = buffer.data();
+    sort(order.begin(), order.end(), [this, data](uint32_t l, uint32_t r) {
+        return compare(data + l * _record_size, data + r * _record_size, _record_size) < 0;
+    });
+
+    // the duplicates within the run are removed already
+    const string run = path("run-" + to_string(run_index));
+    RecordWriter writer(run, _record_size);
+    const uint16_t * last = nullptr;
+    for (const auto i: order) {
+        const uint16_t * record = data + i * _record_size;
+        if (last != nullptr && compare(last, record, _key_size) == 0) { continue; }
+        writer.put(record);
+        last = record;
+    }
+    buffer.clear();
+    return writer.finish() ? run : string{};
+}
+
+bool ExternalSearch::merge_runs(const vector<string> & runs, const string & result) {
+    vector<unique_ptr<RecordReader>> readers;
+    for (const auto & run: runs) { readers.push_back(make_unique<RecordReader>(run, _record_size)); }
+
+    auto greater = [this, &readers](size_t l, size_t r) {
+        return compare(readers[l]->record(), readers[r]->record(), _record_size) > 0;
+    };
+    priority_queue<size_t, vector<size_t>, decltype(greater)> heads(greater);
+    for (size_t i = 0; i < readers.size(); ++i) {
+        if (readers[i]->valid()) { heads.push(i); }
+    }
+
+    RecordWriter writer(result, _record_size);
+    vector<uint16_t> last;
+    while (!heads.empty()) {
+        const size_t i = heads.top();
+        heads.pop();
+
+        const uint16_t * record = readers[i]->record();
+        if (last.empty() || compare(last.data(), record, _key_size) != 0) {
+            writer.put(record);
+            last.assign(record, record + _record_size);
+        }
+        if (readers[i]->next()) { heads.push(i); }
+    }
+
+    bool ok = writer.finish();
+    for (const auto & reader: readers) { ok = ok && !reader->failed(); }
+    return ok;
+}
+
+optional<uint64_t> ExternalSearch::subtract_closed(const string & candidates, const string & closed,
+                                                   const string & layer, const string & new_closed) {
+    RecordReader cand_reader(candidates, _record_size);
+    RecordReader closed_reader(closed, _record_size);
+    RecordWriter layer_writer(layer, _record_size);
+    RecordWriter closed_writer(new_closed, _record_size);
+
+    for (; cand_reader.valid(); cand_reader.next()) {
+        int order = 1;
+        while (closed_reader.valid() &&
+               (order = compare(closed_reader.record(), cand_reader.record(), _key_size)) < 0) {
+            closed_writer.put(closed_reader.record());
+            closed_reader.next();
+        }
+        if (closed_reader.valid() && order == 0) { continue; }
+
+        layer_writer.put(cand_reader.record());
+        closed_writer.put(cand_reader.record());
+    }
+    for (; closed_reader.valid(); closed_reader.next()) { closed_writer.put(closed_reader.record()); }
+
+    // a truncated layer or closed file would lose states silently
+    const bool layer_ok = layer_writer.finish(), closed_ok = closed_writer.finish();
+    if (!layer_ok || !closed_ok || cand_reader.failed() || closed_reader.failed()) { return nullopt; }
+    return layer_writer.count();
+}
+
+optional<vector<PushInfo>> ExternalSearch::recover_path(const vector<string> & layers, vector<PushInfo> tail,
+                                                        vector<uint16_t> state) {
+    // the state is in the last layer, every state of a layer has a parent in the previous one
+    vector<uint16_t> child(_record_size);
+    for (size_t depth = layers.size() - 1; depth-- > 0;) {
+        bool found = false;
+        RecordReader reader(layers[depth], _record_size);
+        for (; reader.valid() && !found; reader.next()) {
+            const BoxState parent = from_record(reader.record());
+            _board.set_boxstate(parent);
+            for (const auto & [pushinfo, stats]: _board.possible_pushes()) {
+                _board.set_boxstate_and_push(parent, pushinfo);
+                to_record(_board.current_state(), child.data());
+                if (compare(child.data(), state.data(), _key_size) != 0) { continue; }
+
+                tail.push_back(pushinfo);
+                state.assign(reader.record(), reader.record() + _record_size);
+                found = true;
+                break;
+            }
+        }
+        // the layer files are damaged
+        if (!found || reader.failed()) { return nullopt; }
+    }
+    reverse(tail.begin(), tail.end());
+    return tail;
+}
+
+optional<vector<PushInfo>> ExternalSearch::fail(ExternalStatus status) {
+    _status = status;
+    return nullopt;
+}
+
+optional<vector<PushInfo>> ExternalSearch::solve() {
+    _status = ExternalStatus::Solved;
+    if (_board.is_complete()) { return vector<PushInfo>{}; }
+    if (mkdir(_options.directory.c_str(), 0755) != 0 && errno != EEXIST) { return fail(ExternalStatus::IoError); }
+
+    vector<uint16_t> record(_record_size);
+    to_record(_board.current_state(), record.data());
+
+    vector<string> layers{ path("layer-0") };
+    string closed = path("closed-0");
+    for (const auto & file: { layers.front(), closed }) {
+        RecordWriter writer(file, _record_size);
+        writer.put(record.data());
+        if (!writer.finish()) { return fail(ExternalStatus::IoError); }
+    }
+    uint64_t closed_size = 1u;
+
+    const size_t run_records = max<size_t>(1u, _options.run_bytes / (_record_size * sizeof(uint16_t)));
+    vector<uint16_t> buffer;
+    buffer.reserve(run_records * _record_size);
+
+    for (size_t depth = 0; _options.max_depth == 0u || depth < _options.max_depth; ++depth) {
+        // the generated states are sorted in runs of the size of the buffer
+        vector<string> runs;
+        RecordReader reader(layers[depth], _record_size);
+        for (; reader.valid(); reader.next()) {
+            const BoxState state = from_record(reader.record());
+            _board.set_boxstate(state);
+            for (const auto & [pushinfo, stats]: _board.possible_pushes()) {
+                _board.set_boxstate_and_push(state, pushinfo);
+                if (_board.is_complete()) {
+                    auto path = recover_path(layers, { pushinfo },
+                                             vector<uint16_t>(reader.record(), reader.record() + _record_size));
+                    return path.has_value() ? path : fail(ExternalStatus::IoError);
+                }
+
+                buffer.resize(buffer.size() + _record_size);
+                to_record(_board.current_state(), buffer.data() + buffer.size() - _record_size);
+                if (buffer.size() >= run_records * _record_size) {
+                    runs.push_back(write_run(buffer, runs.size()));
+                    if (runs.back().empty()) { return fail(ExternalStatus::IoError); }
+                }
+            }
+        }
+        if (reader.failed()) { return fail(ExternalStatus::IoError); }
+        if (!buffer.empty()) {
+            runs.push_back(write_run(buffer, runs.size()));
+            if (runs.back().empty()) { return fail(ExternalStatus::IoError); }
+        }
+
+        const string candidates = path("candidates");
+        const bool merged = merge_runs(runs, candidates);
+        for (const auto & run: runs) { remove(run.c_str()); }
+        if (!merged) { return fail(ExternalStatus::IoError); }
+
+        // the delayed duplicate detection against all earlier layers
+        layers.push_back(path("layer-" + to_string(depth + 1)));
+        const string new_closed = path("closed-" + to_string(depth + 1));
+        const auto layer_size = subtract_closed(candidates, closed, layers.back(), new_closed);
+        remove(candidates.c_str());
+        if (!layer_size.has_value()) { return fail(ExternalStatus::IoError); }
+        remove(closed.c_str());
+        closed = new_closed;
+        closed_size += layer_size.value();
+
+        if (_options.on_layer) { _options.on_layer(depth + 1, layer_size.value(), closed_size); }
+        if (layer_size.value() == 0u) { return fail(ExternalStatus::Unsolvable); }
+    }
+    return fail(ExternalStatus::DepthLimit);
+}
@@ -0,0 +1,84 @@
+#ifndef SOKOBAN_EXTERNAL_SEARCH_H
+#define SOKOBAN_EXTERNAL_SEARCH_H
+
+#include "sokoban_common.h"
+#include "sokoban_pushinfo.h"
+
+#include <vector>
+#include <string>
+#include <optional>
+#include <functional>
+#include <cstdint>
+
+namespace Sokoban
+{
+class Board;
+class BoxState;
+
+// The parameters of the external-memory search
+struct ExternalSearchOptions {
+    std::string directory = ".";        // of the layer files, is created if it doesn't exist
+    size_t run_bytes = 64u << 20;       // the memory for the sorted runs of the generated states
+    size_t max_depth = 0u;              // 0 - unlimited
+    // is called after every layer with its depth, its size and the number of all states
+    std::function<void(size_t, std::uint64_t, std::uint64_t)> on_layer;
+};
+
+// How the external search ended
+enum class ExternalStatus {
+    Solved,
+    Unsolvable,     // the last layer is empty
+    DepthLimit,
+    IoError,        // a file can't be written or read back completely (e.g. the disk is full)
+};
+
+// Breadth-first search by pushes, the layers live on the disk.
+// A state is a fixed-size record: the sorted boxes and the player (the key),
+// then the boxes in the order of their identities (the routes of the boxes
+// depend on it). The states generated from a layer are collected in memory
+// up to run_bytes, sorted and written as runs. The runs are merged, and one
+// merge with the sorted file of all earlier states removes the duplicates
+// (delayed duplicate detection) and writes both the next layer and the new
+// file of all states. All files are read and written sequentially through
+// large buffers. The layers are kept until the end of the search: the
+// solution is recovered backwards, by finding a parent of the current state
+// in the previous layer. The solution is optimal by pushes.
+class ExternalSearch {
+public:
+    using Options = ExternalSearchOptions;
+
+private:
+    Board & _board;
+    Options _options;
+    size_t _box_count;
+    size_t _key_size, _record_size;     // in 16-bit words
+    std::vector<std::string> _files;    // are removed at the end
+    ExternalStatus _status = ExternalStatus::Solved;
+
+    std::string path(const std::string & name);
+    void to_record(const BoxState & bs, std::uint16_t * record) const;
+    BoxState from_record(const std::uint16_t * record) const;
+
+    std::string write_run(std::vector<std::uint16_t> & buffer, size_t run_index);
+    // the i/o functions return false or nullopt on errors
+    bool merge_runs(const std::vector<std::string> & runs, const std::string & result);
+    std::optional<std::uint64_t> subtract_closed(const std::string & candidates, const std::string & closed,
+                                                 const std::string & layer, const std::string & new_closed);
+    std::optional<std::vector<PushInfo>> recover_path(const std::vector<std::string> & layers,
+                                                      std::vector<PushInfo> tail, std::vector<std::uint16_t> state);
+    std::optional<std::vector<PushInfo>> fail(ExternalStatus status);
+
+public:
+    ExternalSearch(Board & board, const Options & options);
+    ~ExternalSearch();
+
+    ExternalSearch(const ExternalSearch &) = delete;
+    ExternalSearch & operator=(const ExternalSearch &) = delete;
+
+    // nullopt if no solution is found, see status() for the reason
+    std::optional<std::vector<PushInfo>> solve();
+    ExternalStatus status() const { return _status; }
+};
+}
+
+#endif
@@ -0,0 +1,40 @@
+#include "sokoban_level_symmetry.h"
+
+using namespace Sokoban;
+using namespace std;
+
+vector<bool> Sokoban::reachable_area(const vector<Tile> & maze, size_t width, size_t height) {
+    const size_t count = width * height;
+    vector<bool> reached(count, false);
+    vector<size_t> stack;
+    for (size_t i = 0; i < count; ++i) {
+        if (tile_is_player(maze[i])) { reached[i] = true; stack.push_back(i); }
+    }
+
+    while (!stack.empty()) {
+        const size_t i = stack.back();
+        stack.pop_back();
+
+        const size_t x = i % width, y = i / width;
+        for (const auto & [nx, ny]: { pair{ x - 1, y }, pair{ x + 1, y }, pair{ x, y - 1 }, pair{ x, y + 1 } }) {
+            if (nx >= width || ny >= height) { continue; }
+            const size_t n = ny * width + nx;
+            if (!reached[n] && !tile_is_wall(maze[n])) { reached[n] = true; stack.push_back(n); }
+        }
+    }
+    return reached;
+}
+
+pair<size_t, size_t> RectangleSymmetry::forward(size_t x, size_t y) const {
+    if (transposed()) { swap(x, y); }
+    if (_symmetry & 1u) { x = width() - 1u - x; }
+    if (_symmetry & 2u) { y = height() - 1u - y; }
+    return { x, y };
+}
+
+pair<size_t, size_t> RectangleSymmetry::backward(size_t x, size_t y) const {
+    if (_symmetry & 1u) { x = width() - 1u - x; }
+    if (_symmetry & 2u) { y = height() - 1u - y; }
+    if (transposed()) { swap(x, y); }
+    return { x, y };
+}
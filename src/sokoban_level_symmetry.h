@@ -0,0 +1,40 @@
+// The area of a level reachable by the player and the rotations and
+// reflections of a rectangle. They are shared by the symmetry pruning of the
+// search (BoardState) and the canonical levels of the solution cache.
+
+#ifndef SOKOBAN_LEVEL_SYMMETRY_H
+#define SOKOBAN_LEVEL_SYMMETRY_H
+
+#include "sokoban_common.h"
+
+#include <vector>
+#include <utility>
+
+namespace Sokoban
+{
+// the tiles reachable by the player, boxes don't stop it; none if the level has no player
+std::vector<bool> reachable_area(const std::vector<Tile> & maze, size_t width, size_t height);
+
+// One of 8 rotations and reflections of a width x height rectangle
+class RectangleSymmetry {
+    size_t _width, _height;
+    unsigned _symmetry;     // bit 2 - transposed, then bit 0 - mirrored x, bit 1 - mirrored y
+
+public:
+    RectangleSymmetry(size_t width, size_t height, unsigned symmetry)
+        : _width{ width }, _height{ height }, _symmetry{ symmetry } {}
+
+    unsigned symmetry() const { return _symmetry; }
+    bool transposed() const { return (_symmetry & 4u) != 0u; }
+
+    // the size of the transformed rectangle
+    size_t width() const  { return transposed() ? _height : _width; }
+    size_t height() const { return transposed() ? _width : _height; }
+
+    // the coordinates in the transformed rectangle for the original ones and back
+    std::pair<size_t, size_t> forward(size_t x, size_t y) const;
+    std::pair<size_t, size_t> backward(size_t x, size_t y) const;
+};
+}
+
+#endif
@@ -0,0 +1,90 @@
+#include "sokoban_move_reconstruction.h"
+
+#include <cctype>
+
+using namespace Sokoban;
+using namespace std;
+
+namespace
+{
+// by the order of Direction: Up, Left, Right, Down
+constexpr Direction OPPOSITE[DIR_COUNT] = { Direction::Down, Direction::Right, Direction::Left, Direction::Up };
+}
+
+optional<index_t> MoveReconstructor::Grid::neighbour(index_t index, Direction d) const {
+    switch (d) {
+        case Direction::Left:
+            if (index % width == 0) { return nullopt; }
+            return static_cast<index_t>(index - 1u);
+        case Direction::Right:
+            if (index % width == width - 1) { return nullopt; }
+            return static_cast<index_t>(index + 1u);
+        case Direction::Up:
+            if (index < width) { return nullopt; }
+            return static_cast<index_t>(index - width);
+        case Direction::Down:
+            if (index + width >= count) { return nullopt; }
+            return static_cast<index_t>(index + width);
+        default:
+            return nullopt;
+    }
+}
+
+MoveReconstructor::MoveReconstructor(const vector<Tile> & maze, size_t width) {
+    _grid.width = width;
+    _grid.count = maze.size();
+
+    for (index_t i = 0; i < maze.size(); ++i) {
+        _grid.walls[i]  = tile_is_wall(maze[i]);
+        _start_boxes[i] = tile_is_box(maze[i]);
+        if (tile_is_player(maze[i])) { _start_player = i; }
+    }
+    _traversal.reserve(maze.size());
+}
+
+// appends the shortest walk of the player to the target
+bool MoveReconstructor::walk(index_t & player, index_t target, string & moves) {
+    if (player == target) { return true; }
+
+    _traversal.bfs(_grid, target);
+    if (!_traversal.visited(player)) { return false; }
+
+    while (player != target) {
+        const auto dist = _traversal.distance(player);
+        for (const auto d: { Direction::Left, Direction::Up, Direction::Right, Direction::Down }) {
+            const auto next = _grid.neighbour(player, d);
+            if (next.has_value() && _traversal.distance(next.value()) + 1u == dist) {
+                moves.push_back(static_cast<char>(tolower(to_char(d))));
+                player = next.value();
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+optional<string> MoveReconstructor::moves(const vector<PushInfo> & pushes) {
+    _grid.boxes = _start_boxes;
+    index_t player = _start_player;
+
+    string result;
+    result.reserve(pushes.size() * 4u);
+
+    for (const auto & pi: pushes) {
+        const auto dir = direction(pi.from(), pi.to());
+        if (!_grid.boxes[pi.from()] || _grid.neighbour(pi.from(), dir) != pi.to()) { return nullopt; }
+        if (_grid.walls[pi.to()] || _grid.boxes[pi.to()]) { return nullopt; }
+
+        // the player stands on the opposite side of the box
+        const auto behind = _grid.neighbour(pi.from(), OPPOSITE[static_cast<size_t>(dir)]);
+        if (!behind.has_value() || _grid.walls[behind.value()] || _grid.boxes[behind.value()]) { return nullopt; }
+        if (!walk(player, behind.value(), result)) { return nullopt; }
+
+        result.push_back(to_char(dir));
+        _grid.boxes[pi.from()] = false;
+        _grid.boxes[pi.to()]   = true;
+        player = pi.from();
+    }
+
+    return result;
+}
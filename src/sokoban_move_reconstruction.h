@@ -0,0 +1,57 @@
+#ifndef SOKOBAN_MOVE_RECONSTRUCTION_H
+#define SOKOBAN_MOVE_RECONSTRUCTION_H
+
+#include "sokoban_common.h"
+#include "sokoban_pushinfo.h"
+#include "graph_traversal.h"
+
+#include <vector>
+#include <string>
+#include <optional>
+
+namespace Sokoban
+{
+// Expands the pushes of a solution into the moves of the player in the LURD
+// notation: lower case letters are walks, upper case letters are pushes.
+// Every walk is a shortest path to the tile behind the pushed box. The
+// breadth-first search starts from that tile, so the path is read forward
+// from the player by stepping to any neighbour one step closer. The boxes are
+// a bitset over the grid, and one traversal with its scratch buffers serves
+// all pushes.
+class MoveReconstructor {
+    // the grid of the level with the boxes as obstacles, is traversed as a graph
+    struct Grid {
+        flags walls, boxes;
+        size_t width, count;
+
+        size_t size() const { return count; }
+
+        template <typename Fn>
+        void for_each_edge(const index_t index, Fn && fn) const {
+            for (const auto d: { Direction::Left, Direction::Up, Direction::Right, Direction::Down }) {
+                const auto next = neighbour(index, d);
+                if (next.has_value() && !walls[next.value()] && !boxes[next.value()]) {
+                    fn(next.value());
+                }
+            }
+        }
+
+        std::optional<index_t> neighbour(index_t index, Direction d) const;
+    };
+
+    Grid _grid;
+    index_t _start_player = 0u;
+    flags _start_boxes;
+    GraphTraversal<index_t> _traversal;
+
+    bool walk(index_t & player, index_t target, std::string & moves);
+
+public:
+    MoveReconstructor(const std::vector<Tile> & maze, size_t width);
+
+    // the moves of the solution, nullopt if any push is impossible
+    std::optional<std::string> moves(const std::vector<PushInfo> & pushes);
+};
+}
+
+#endif
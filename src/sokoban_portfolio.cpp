@@ -0,0 +1,113 @@
+#include "sokoban_portfolio.h"
+#include "sokoban_solver.h"
+
+#include <sstream>
+#include <ostream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+using namespace Sokoban;
+using namespace std;
+
+const char * Sokoban::to_string(PortfolioStrategy strategy) {
+    switch (strategy) {
+        case PortfolioStrategy::Greedy:    return "greedy";
+        case PortfolioStrategy::GoalOrder: return "goal-order";
+        case PortfolioStrategy::Distance:  return "distance";
+        case PortfolioStrategy::Beam:      return "beam";
+        default:                           return "unknown";
+    }
+}
+
+Portfolio::Portfolio(const Options & options) : _options{ options } {
+    for (size_t i = 0; i < _options.strategies.size(); ++i) { _solvers.push_back(make_unique<Solver>()); }
+}
+
+Portfolio::~Portfolio() = default;
+
+optional<PortfolioResult> Portfolio::solve(const string & level) {
+    using clock = chrono::steady_clock;
+    const auto start = clock::now();
+    ++_levels;
+
+    atomic<bool> cancel{ false };
+    mutex result_mutex;
+    condition_variable finished_cv;
+    size_t finished = 0u;
+    optional<PortfolioResult> result;
+
+    auto run = [&](size_t i) {
+        const PortfolioStrategy strategy = _options.strategies[i];
+        Solver & solver = *_solvers[i];
+
+        bool solved = false, exhausted = false;
+        istringstream iss(level);
+        if (solver.read_level_data(iss)) {
+            if (strategy == PortfolioStrategy::Beam) {
+                BeamOptions beam = _options.beam;
+                beam.cancel = &cancel;
+                solved = solver.solve_beam(beam);
+            } else {
+                solver.set_greedy_priority(strategy == PortfolioStrategy::GoalOrder ? GreedyPriority::GoalOrder
+                                         : strategy == PortfolioStrategy::Distance  ? GreedyPriority::Distance
+                                                                                    : GreedyPriority::Combined);
+                SearchLimits limits;
+                limits.cancel = &cancel;
+                limits.max_states = _options.max_states;
+                solved = solver.solve(limits);
+                exhausted = solver.stop_reason() == StopReason::Exhausted;
+            }
+        } else {
+            // the other strategies fail to read the level too
+            exhausted = true;
+        }
+
+        optional<string> moves;
+        if (solved) { moves = solver.solution_moves(); }
+
+        lock_guard<mutex> lock(result_mutex);
+        if (solved && !result.has_value()) {
+            result = PortfolioResult{ strategy, solver.solution().value(), move(moves), solver.state_count(),
+                                      chrono::duration_cast<chrono::milliseconds>(clock::now() - start) };
+            cancel.store(true);
+        } else if (exhausted && !cancel.load()) {
+            cancel.store(true);
+        }
+        ++finished;
+        finished_cv.notify_all();
+    };
+
+    vector<thread> threads;
+    for (size_t i = 0; i < _options.strategies.size(); ++i) { threads.emplace_back(run, i); }
+
+    {
+        unique_lock<mutex> lock(result_mutex);
+        auto all_finished = [&]{ return finished == threads.size(); };
+        if (_options.time_budget.count() > 0) {
+            finished_cv.wait_until(lock, start + _options.time_budget, all_finished);
+        } else {
+            finished_cv.wait(lock, all_finished);
+        }
+        cancel.store(true);
+    }
+    for (auto & thread: threads) { thread.join(); }
+
+    if (result.has_value()) {
+        auto & stats = _stats[static_cast<size_t>(result->winner)];
+        ++stats.wins;
+        stats.time += result->time;
+    }
+    return result;
+}
+
+void Portfolio::print_statistics(ostream & stream) const {
+    stream << "Portfolio statistics (" << _levels << " levels):" << '\n';
+    for (size_t i = 0; i < STRATEGY_COUNT; ++i) {
+        const auto & stats = _stats[i];
+        stream << "  " << to_string(static_cast<PortfolioStrategy>(i)) << ": " << stats.wins << " wins";
+        if (stats.wins > 0u) { stream << ", " << stats.time.count() / stats.wins << " ms on average"; }
+        stream << '\n';
+    }
+}
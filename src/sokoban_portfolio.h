@@ -0,0 +1,86 @@
+#ifndef SOKOBAN_PORTFOLIO_H
+#define SOKOBAN_PORTFOLIO_H
+
+#include "sokoban_common.h"
+#include "sokoban_pushinfo.h"
+#include "sokoban_beam_search.h"
+
+#include <vector>
+#include <array>
+#include <string>
+#include <memory>
+#include <optional>
+#include <chrono>
+#include <iosfwd>
+
+namespace Sokoban
+{
+class Solver;
+
+enum class PortfolioStrategy : unsigned char {
+    Greedy,         // the greedy search with GreedyPriority::Combined
+    GoalOrder,      // the greedy search with GreedyPriority::GoalOrder
+    Distance,       // the greedy search with GreedyPriority::Distance
+    Beam,           // the beam search with restarts
+    Count
+};
+
+static constexpr size_t STRATEGY_COUNT = static_cast<size_t>(PortfolioStrategy::Count);
+
+const char * to_string(PortfolioStrategy strategy);
+
+struct PortfolioOptions {
+    std::vector<PortfolioStrategy> strategies{
+        PortfolioStrategy::Greedy, PortfolioStrategy::GoalOrder,
+        PortfolioStrategy::Distance, PortfolioStrategy::Beam };
+    std::chrono::milliseconds time_budget{ 0 };     // 0 - unlimited
+    size_t max_states = 0u;                         // of every greedy search, 0 - unlimited
+    BeamOptions beam{ 1000u, 64000u, 0u, nullptr, {} };
+};
+
+struct PortfolioResult {
+    PortfolioStrategy winner;
+    std::vector<PushInfo> solution;
+    std::optional<std::string> moves;               // in the LURD notation
+    size_t states = 0u;                             // of the winning search
+    std::chrono::milliseconds time{ 0 };
+};
+
+// Races the differently configured searches of one level, every search runs
+// in its own thread with its own solver (and board). The first found solution
+// wins and the other searches are cancelled through their cancellation flags;
+// a greedy search which fails without a limit proves the level unsolvable and
+// stops the race as well. The solvers are kept for the next levels, and the
+// wins of every strategy are counted to tune the mix of the strategies.
+class Portfolio {
+public:
+    using Options = PortfolioOptions;
+
+private:
+    struct Stats {
+        size_t wins = 0u;
+        std::chrono::milliseconds time{ 0 };        // the sum of the times of the wins
+    };
+
+    Options _options;
+    std::vector<std::unique_ptr<Solver>> _solvers; // one per strategy of the options
+    std::array<Stats, STRATEGY_COUNT> _stats{};
+    size_t _levels = 0u;
+
+public:
+    explicit Portfolio(const Options & options = {});
+    ~Portfolio();
+
+    Portfolio(const Portfolio &) = delete;
+    Portfolio & operator=(const Portfolio &) = delete;
+
+    // nullopt if the level is invalid or unsolvable, or the budget ran out
+    std::optional<PortfolioResult> solve(const std::string & level);
+
+    size_t wins(PortfolioStrategy strategy) const { return _stats[static_cast<size_t>(strategy)].wins; }
+    size_t level_count() const { return _levels; }
+    void print_statistics(std::ostream & stream) const;
+};
+}
+
+#endif
@@ -0,0 +1,298 @@
+#include "sokoban_service.h"
+#include "sokoban_solver.h"
+#include "sokoban_solution_cache.h"
+#include "string_join.h"
+
+#include <sstream>
+#include <unordered_map>
+#include <cstring>
+#include <cerrno>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace Sokoban;
+using namespace std;
+
+namespace
+{
+void put_u32(string & data, uint32_t value) {
+    for (int shift = 24; shift >= 0; shift -= 8) { data.push_back(static_cast<char>((value >> shift) & 0xFFu)); }
+}
+
+void put_u64(string & data, uint64_t value) {
+    put_u32(data, static_cast<uint32_t>(value >> 32));
+    put_u32(data, static_cast<uint32_t>(value));
+}
+
+uint32_t get_u32(const char * data) {
+    uint32_t value = 0u;
+    for (size_t i = 0; i < 4u; ++i) { value = (value << 8) | static_cast<unsigned char>(data[i]); }
+    return value;
+}
+
+bool read_exact(int fd, char * data, size_t size) {
+    while (size > 0u) {
+        const ssize_t count = recv(fd, data, size, 0);
+        if (count < 0 && errno == EINTR) { continue; }
+        if (count <= 0) { return false; }
+        data += count;
+        size -= static_cast<size_t>(count);
+    }
+    return true;
+}
+
+// the smallest level to initialize the solver of a worker
+const char * WARMUP_LEVEL = "#####\n#@$.#\n#####\n";
+}
+
+struct SolverService::Connection {
+    int fd;
+    mutex write_mutex;
+    mutex jobs_mutex;
+    unordered_map<uint32_t, shared_ptr<atomic<bool>>> active;
+
+    explicit Connection(int fd) : fd{ fd } { }
+    ~Connection() { ::close(fd); }
+
+    // the frames of the workers are not interleaved, a closed peer is ignored
+    void send(uint8_t type, const string & payload) {
+        string frame;
+        frame.reserve(payload.size() + 5u);
+        put_u32(frame, static_cast<uint32_t>(payload.size() + 1u));
+        frame.push_back(static_cast<char>(type));
+        frame += payload;
+
+        lock_guard<mutex> lock(write_mutex);
+        const char * data = frame.data();
+        size_t size = frame.size();
+        while (size > 0u) {
+            const ssize_t count = ::send(fd, data, size, MSG_NOSIGNAL);
+            if (count < 0 && errno == EINTR) { continue; }
+            if (count <= 0) { return; }
+            data += count;
+            size -= static_cast<size_t>(count);
+        }
+    }
+
+    void cancel_all() {
+        lock_guard<mutex> lock(jobs_mutex);
+        for (auto & [id, flag]: active) { flag->store(true); }
+    }
+};
+
+SolverService::SolverService(string path, const Options & options)
+    : _path{ move(path) }, _options{ options } {
+}
+
+SolverService::~SolverService() {
+    stop();
+    if (_listen_fd >= 0) {
+        ::close(_listen_fd);
+        unlink(_path.c_str());
+    }
+}
+
+bool SolverService::listen() {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (_path.size() >= sizeof(address.sun_path)) { return false; }
+    memcpy(address.sun_path, _path.c_str(), _path.size() + 1u);
+
+    _listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (_listen_fd < 0) { return false; }
+
+    // the socket file of a crashed service is replaced
+    unlink(_path.c_str());
+    if (bind(_listen_fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0 ||
+        ::listen(_listen_fd, SOMAXCONN) != 0) {
+        ::close(_listen_fd);
+        _listen_fd = -1;
+        return false;
+    }
+
+    for (size_t i = 0; i < max<size_t>(1u, _options.workers); ++i) {
+        _workers.emplace_back([this]{ work(); });
+    }
+    return true;
+}
+
+void SolverService::serve() {
+    for (;;) {
+        const int fd = accept(_listen_fd, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) { continue; }
+            return;
+        }
+
+        auto connection = make_shared<Connection>(fd);
+        {
+            lock_guard<mutex> lock(_mutex);
+            if (_stopping) { return; }
+            _connections.push_back(connection);
+            ++_reader_count;
+        }
+        thread([this, connection]{ read_requests(connection); }).detach();
+    }
+}
+
+void SolverService::stop() {
+    unique_lock<mutex> lock(_mutex);
+    if (_stopping) { return; }
+    _stopping = true;
+
+    // the blocked calls return with errors
+    if (_listen_fd >= 0) { shutdown(_listen_fd, SHUT_RDWR); }
+    for (const auto & connection: _connections) {
+        shutdown(connection->fd, SHUT_RDWR);
+        connection->cancel_all();
+    }
+    _jobs.clear();
+    _cv.notify_all();
+    _cv.wait(lock, [this]{ return _reader_count == 0u; });
+    lock.unlock();
+
+    for (auto & worker: _workers) { worker.join(); }
+    _workers.clear();
+}
+
+void SolverService::read_requests(shared_ptr<Connection> connection) {
+    for (;;) {
+        char header[4];
+        if (!read_exact(connection->fd, header, sizeof(header))) { break; }
+
+        const uint32_t size = get_u32(header);
+        if (size == 0u || size > MAX_FRAME_SIZE) { break; }
+
+        string frame(size, '\0');
+        if (!read_exact(connection->fd, frame.data(), size)) { break; }
+
+        const auto type = static_cast<uint8_t>(frame[0]);
+        if (type == SOLVE && size >= 13u) {
+            Job job{ connection, get_u32(&frame[1]), get_u32(&frame[5]), get_u32(&frame[9]),
+                     frame.substr(13), make_shared<atomic<bool>>(false), chrono::steady_clock::now() };
+            {
+                lock_guard<mutex> lock(connection->jobs_mutex);
+                connection->active[job.id] = job.cancel;
+            }
+            lock_guard<mutex> lock(_mutex);
+            if (_stopping) { break; }
+            _jobs.push_back(move(job));
+            _cv.notify_one();
+        } else if (type == CANCEL && size >= 5u) {
+            lock_guard<mutex> lock(connection->jobs_mutex);
+            auto it = connection->active.find(get_u32(&frame[1]));
+            if (it != connection->active.end()) { it->second->store(true); }
+        } else {
+            break;
+        }
+    }
+
+    // the searches for the closed connection are useless
+    connection->cancel_all();
+
+    lock_guard<mutex> lock(_mutex);
+    _connections.remove(connection);
+    --_reader_count;
+    _cv.notify_all();
+}
+
+void SolverService::work() {
+    Solver solver;
+    istringstream warmup(WARMUP_LEVEL);
+    if (solver.read_level_data(warmup)) { solver.solve(); }
+
+    for (;;) {
+        Job job;
+        {
+            unique_lock<mutex> lock(_mutex);
+            _cv.wait(lock, [this]{ return _stopping || !_jobs.empty(); });
+            if (_stopping) { return; }
+
+            job = move(_jobs.front());
+            _jobs.pop_front();
+        }
+
+        process(solver, job);
+
+        lock_guard<mutex> lock(job.connection->jobs_mutex);
+        auto it = job.connection->active.find(job.id);
+        if (it != job.connection->active.end() && it->second == job.cancel) {
+            job.connection->active.erase(it);
+        }
+    }
+}
+
+void SolverService::process(Solver & solver, const Job & job) {
+    using clock = chrono::steady_clock;
+
+    auto respond = [&job](Status status, size_t states, const string & text) {
+        string payload;
+        put_u32(payload, job.id);
+        payload.push_back(static_cast<char>(status));
+        put_u64(payload, states);
+        payload += text;
+        job.connection->send(RESULT, payload);
+    };
+
+    if (job.cancel->load()) { respond(Status::Cancelled, 0u, {}); return; }
+
+    const auto deadline = job.arrival + chrono::milliseconds{ job.time_budget };
+    if (job.time_budget != 0u && clock::now() >= deadline) { respond(Status::Timeout, 0u, {}); return; }
+
+    istringstream iss(job.level);
+    if (!solver.read_level_data(iss)) { respond(Status::Invalid, 0u, {}); return; }
+
+    SearchLimits limits;
+    limits.cancel = job.cancel.get();
+    if (job.time_budget != 0u) { limits.deadline = deadline; }
+    limits.max_states = _options.max_states;
+    limits.max_memory = _options.max_memory;
+    if (job.max_states != 0u && (limits.max_states == 0u || job.max_states < limits.max_states)) {
+        limits.max_states = job.max_states;
+    }
+
+    auto last_progress = clock::now();
+    limits.on_progress = [&](const SearchProgress & progress) {
+        const auto now = clock::now();
+        if (now - last_progress < _options.progress_interval) { return; }
+        last_progress = now;
+
+        string payload;
+        put_u32(payload, job.id);
+        put_u64(payload, progress.expanded);
+        put_u64(payload, progress.stored);
+        job.connection->send(PROGRESS, payload);
+    };
+
+    auto respond_solved = [&](size_t states) {
+        const auto moves = solver.solution_moves();
+        respond(Status::Solved, states,
+                string_join(solver.solution().value(), " ") + '\n' + moves.value_or(string{}));
+    };
+
+    if (_options.cache && solver.load_solution(*_options.cache)) {
+        respond_solved(0u);
+        return;
+    }
+
+    const auto start = clock::now();
+    if (solver.solve(limits)) {
+        if (_options.cache) {
+            solver.store_solution(*_options.cache,
+                                  chrono::duration_cast<chrono::milliseconds>(clock::now() - start));
+        }
+        respond_solved(solver.state_count());
+        return;
+    }
+
+    Status status = Status::LimitExceeded;
+    switch (solver.stop_reason()) {
+        case StopReason::Exhausted: status = Status::Unsolvable; break;
+        case StopReason::Cancelled: status = Status::Cancelled;  break;
+        case StopReason::Deadline:  status = Status::Timeout;    break;
+        default: break;
+    }
+    respond(status, solver.state_count(), {});
+}
@@ -0,0 +1,111 @@
+// Long-running solver service over a local Unix domain socket.
+// Worker threads keep their solvers (with the allocated tables and the
+// initialized deadlock patterns) between the requests, so a small level
+// costs only its own search.
+//
+// Every message is a frame: the length of the rest of the frame (uint32),
+// the type of the message (uint8) and the payload. All integers are in the
+// network byte order.
+//   Requests:
+//     'S' solve:    uint32 id, uint32 time budget in ms (from the arrival of
+//                   the request, the time in the queue counts), uint32 state
+//                   limit (0 - the default of the service), the level text
+//     'C' cancel:   uint32 id
+//   Responses:
+//     'P' progress: uint32 id, uint64 expanded states, uint64 stored states
+//     'R' result:   uint32 id, uint8 status, uint64 stored states (0 for the
+//                   solution from the cache), and for the solved level the
+//                   pushes and the moves (LURD) on two lines
+// The requests of one connection are independent, the results come in the
+// order of completion. The state limit is the memory budget of a request:
+// the stored states take most of the memory of a search.
+
+#ifndef SOKOBAN_SERVICE_H
+#define SOKOBAN_SERVICE_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <list>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace Sokoban
+{
+class Solver;
+class SolutionCache;
+
+struct ServiceOptions {
+    size_t workers    = 1;
+    size_t max_states = 0u;     // the limit of every request, 0 - unlimited
+    size_t max_memory = 0u;     // of the search of every request in bytes, 0 - unlimited
+    std::chrono::milliseconds progress_interval{ 200 };
+    std::shared_ptr<SolutionCache> cache;   // is consulted before every search
+};
+
+class SolverService {
+public:
+    enum class Status : std::uint8_t {
+        Solved = 0, Unsolvable, Cancelled, Timeout, LimitExceeded, Invalid
+    };
+
+    static constexpr std::uint8_t SOLVE    = 'S';
+    static constexpr std::uint8_t CANCEL   = 'C';
+    static constexpr std::uint8_t PROGRESS = 'P';
+    static constexpr std::uint8_t RESULT   = 'R';
+
+    static constexpr size_t MAX_FRAME_SIZE = 1u << 16;
+
+    using Options = ServiceOptions;
+
+private:
+    struct Connection;
+
+    struct Job {
+        std::shared_ptr<Connection> connection;
+        std::uint32_t id;
+        std::uint32_t time_budget;
+        std::uint32_t max_states;
+        std::string level;
+        std::shared_ptr<std::atomic<bool>> cancel;
+        std::chrono::steady_clock::time_point arrival;  // the time budget counts from it
+    };
+
+    std::string _path;
+    Options _options;
+    int _listen_fd = -1;
+
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    std::deque<Job> _jobs;
+    std::list<std::shared_ptr<Connection>> _connections;
+    std::vector<std::thread> _workers;
+    size_t _reader_count = 0u;  // the reading threads are detached, stop() waits for them
+    bool _stopping = false;
+
+    void work();
+    void process(Solver & solver, const Job & job);
+    void read_requests(std::shared_ptr<Connection> connection);
+
+public:
+    SolverService(std::string path, const Options & options = {});
+    ~SolverService();
+
+    SolverService(const SolverService &) = delete;
+    SolverService & operator=(const SolverService &) = delete;
+
+    // binds the socket and starts the warmed up workers, returns false on errors
+    bool listen();
+    // accepts the connections until stop() is called
+    void serve();
+    // closes the socket and all connections, the running searches are cancelled
+    void stop();
+};
+}
+
+#endif
@@ -0,0 +1,429 @@
+#include "sokoban_solution_cache.h"
+
+#include <cstring>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace Sokoban;
+using namespace std;
+
+namespace
+{
+constexpr char LOG_MAGIC[8]   = { 'S', 'O', 'K', 'S', 'L', 'O', 'G', '\0' };
+constexpr char INDEX_MAGIC[8] = { 'S', 'O', 'K', 'S', 'I', 'D', 'X', '\0' };
+constexpr uint32_t VERSION       = 1u;
+constexpr uint32_t RECORD_MAGIC  = 0x52454344u;
+constexpr uint32_t MAX_RECORD    = 1u << 24;
+constexpr size_t   LOG_HEADER_SIZE = sizeof(LOG_MAGIC) + 2 * sizeof(uint32_t);
+constexpr size_t   INITIAL_CAPACITY = 1024u;
+
+struct RecordHeader {
+    uint32_t magic;
+    uint32_t size;      // of the payload
+    uint64_t checksum;  // of the payload
+};
+
+uint64_t fnv1a(const char * data, size_t size) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+template <typename T>
+void append(string & data, const T & value) {
+    data.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template <typename T>
+bool extract(const string & data, size_t & pos, T & value) {
+    if (data.size() - pos < sizeof(value)) { return false; }
+    memcpy(&value, data.data() + pos, sizeof(value));
+    pos += sizeof(value);
+    return true;
+}
+
+bool read_exact(int fd, void * data, size_t size, uint64_t offset) {
+    auto * bytes = static_cast<char *>(data);
+    while (size > 0u) {
+        const ssize_t count = pread(fd, bytes, size, static_cast<off_t>(offset));
+        if (count <= 0) { return false; }
+        bytes  += count;
+        size   -= static_cast<size_t>(count);
+        offset += static_cast<uint64_t>(count);
+    }
+    return true;
+}
+
+bool write_exact(int fd, const void * data, size_t size, uint64_t offset) {
+    const auto * bytes = static_cast<const char *>(data);
+    while (size > 0u) {
+        const ssize_t count = pwrite(fd, bytes, size, static_cast<off_t>(offset));
+        if (count <= 0) { return false; }
+        bytes  += count;
+        size   -= static_cast<size_t>(count);
+        offset += static_cast<uint64_t>(count);
+    }
+    return true;
+}
+}
+
+CanonicalLevel::CanonicalLevel(const vector<Tile> & maze, size_t width, size_t height)
+    : _width{ width } {
+    const size_t count = width * height;
+
+    // the tiles reachable by the player, boxes don't stop the fill
+    const auto reached = reachable_area(maze, width, height);
+    const bool has_player = any_of(begin(maze), end(maze), [](Tile t){ return tile_is_player(t); });
+
+    auto normalized = [&](size_t i) {
+        if (tile_is_wall(maze[i]))                                 { return Tile::Wall; }
+        if (has_player && maze[i] == Tile::Floor && !reached[i])  { return Tile::Wall; }
+        return maze[i];
+    };
+
+    size_t left = width, right = 0u, top = height, bottom = 0u;
+    for (size_t i = 0; i < count; ++i) {
+        if (normalized(i) == Tile::Wall) { continue; }
+        left   = min(left, i % width);
+        right  = max(right, i % width);
+        top    = min(top, i / width);
+        bottom = max(bottom, i / width);
+    }
+    size_t crop_width = 0u, crop_height = 0u;
+    if (left <= right) {
+        _left = left;
+        _top  = top;
+        crop_width  = right - left + 1u;
+        crop_height = bottom - top + 1u;
+    }
+
+    for (unsigned symmetry = 0u; symmetry < 8u; ++symmetry) {
+        const RectangleSymmetry transform(crop_width, crop_height, symmetry);
+        const size_t w = transform.width(), h = transform.height();
+
+        string bytes;
+        bytes.reserve(4u + w * h);
+        append(bytes, static_cast<uint16_t>(w));
+        append(bytes, static_cast<uint16_t>(h));
+        for (size_t y = 0; y < h; ++y) {
+            for (size_t x = 0; x < w; ++x) {
+                const auto [cx, cy] = transform.backward(x, y);
+                bytes.push_back(static_cast<char>(normalized((cy + _top) * width + cx + _left)));
+            }
+        }
+
+        if (symmetry == 0u || bytes < _bytes) {
+            _bytes = move(bytes);
+            _symmetry = transform;
+        }
+    }
+
+    _key = fnv1a(_bytes.data(), _bytes.size());
+}
+
+index_t CanonicalLevel::to_canonical(index_t index) const {
+    const auto [x, y] = _symmetry.forward(index % _width - _left, index / _width - _top);
+    return static_cast<index_t>(y * _symmetry.width() + x);
+}
+
+index_t CanonicalLevel::from_canonical(index_t index) const {
+    const auto [x, y] = _symmetry.backward(index % _symmetry.width(), index / _symmetry.width());
+    return static_cast<index_t>((y + _top) * _width + x + _left);
+}
+
+struct SolutionCache::IndexHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t capacity;      // the number of slots, a power of 2
+    uint64_t log_size;      // the length of the log covered by the index
+    uint64_t count;
+};
+
+struct SolutionCache::Slot {
+    uint64_t key;
+    uint64_t offset;        // of the record in the log, 0 - the empty slot
+};
+
+SolutionCache::IndexHeader & SolutionCache::header() const {
+    return *static_cast<IndexHeader *>(_index);
+}
+
+SolutionCache::Slot * SolutionCache::slots() const {
+    return reinterpret_cast<Slot *>(static_cast<char *>(_index) + sizeof(IndexHeader));
+}
+
+SolutionCache::~SolutionCache() {
+    if (_index != nullptr) { munmap(_index, _index_size); }
+    if (_index_fd >= 0)    { ::close(_index_fd); }
+    if (_log_fd >= 0)      { ::close(_log_fd); }
+}
+
+unique_ptr<SolutionCache> SolutionCache::open(const string & path) {
+    unique_ptr<SolutionCache> cache{ new SolutionCache() };
+    cache->_log_path   = path + ".log";
+    cache->_index_path = path + ".idx";
+
+    cache->_log_fd = ::open(cache->_log_path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (cache->_log_fd < 0) { return nullptr; }
+    if (flock(cache->_log_fd, LOCK_EX | LOCK_NB) != 0) { return nullptr; }
+
+    struct stat st;
+    if (fstat(cache->_log_fd, &st) != 0) { return nullptr; }
+    cache->_log_size = static_cast<uint64_t>(st.st_size);
+
+    char log_header[LOG_HEADER_SIZE] = {};
+    if (cache->_log_size < LOG_HEADER_SIZE) {
+        // a new log, or the crash before its header was written
+        memcpy(log_header, LOG_MAGIC, sizeof(LOG_MAGIC));
+        memcpy(log_header + sizeof(LOG_MAGIC), &VERSION, sizeof(VERSION));
+        if (ftruncate(cache->_log_fd, 0) != 0 ||
+            !write_exact(cache->_log_fd, log_header, LOG_HEADER_SIZE, 0u) ||
+            fdatasync(cache->_log_fd) != 0) { return nullptr; }
+        cache->_log_size = LOG_HEADER_SIZE;
+    } else {
+        // a foreign file is never modified
+        uint32_t version = 0u;
+        if (!read_exact(cache->_log_fd, log_header, LOG_HEADER_SIZE, 0u)) { return nullptr; }
+        memcpy(&version, log_header + sizeof(LOG_MAGIC), sizeof(version));
+        if (memcmp(log_header, LOG_MAGIC, sizeof(LOG_MAGIC)) != 0 || version != VERSION) { return nullptr; }
+    }
+
+    cache->_index_fd = ::open(cache->_index_path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (cache->_index_fd < 0) { return nullptr; }
+
+    // the existing index is used if it is consistent with the log
+    if (fstat(cache->_index_fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(IndexHeader)) {
+        IndexHeader h;
+        if (read_exact(cache->_index_fd, &h, sizeof(h), 0u) &&
+            memcmp(h.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) == 0 && h.version == VERSION &&
+            h.capacity != 0u && (h.capacity & (h.capacity - 1u)) == 0u &&
+            static_cast<size_t>(st.st_size) == sizeof(IndexHeader) + h.capacity * sizeof(Slot) &&
+            h.log_size >= LOG_HEADER_SIZE && h.log_size <= cache->_log_size &&
+            cache->map_index(h.capacity, false) &&
+            cache->index_records(h.log_size)) {
+            return cache;
+        }
+    }
+
+    if (!cache->rebuild_index(INITIAL_CAPACITY)) { return nullptr; }
+    return cache;
+}
+
+bool SolutionCache::map_index(size_t capacity, bool create) {
+    if (_index != nullptr) { munmap(_index, _index_size); _index = nullptr; }
+
+    _index_size = sizeof(IndexHeader) + capacity * sizeof(Slot);
+    if (create && ftruncate(_index_fd, static_cast<off_t>(_index_size)) != 0) { return false; }
+
+    void * mapped = mmap(nullptr, _index_size, PROT_READ | PROT_WRITE, MAP_SHARED, _index_fd, 0);
+    if (mapped == MAP_FAILED) { return false; }
+    _index = mapped;
+
+    if (create) {
+        memset(_index, 0, _index_size);
+        auto & h = header();
+        memcpy(h.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+        h.version  = VERSION;
+        h.capacity = static_cast<uint32_t>(capacity);
+        h.log_size = LOG_HEADER_SIZE;
+        h.count    = 0u;
+    }
+    return true;
+}
+
+bool SolutionCache::rebuild_index(size_t capacity) {
+    if (!map_index(capacity, true)) { return false; }
+
+    while (!index_records(header().log_size)) {
+        const uint64_t damaged = header().log_size;
+        uint64_t next = 0u;
+        if (read_key(damaged, next).has_value()) { return false; }  // the index can't be grown
+
+        // a damaged record in the middle of the log is skipped up to the next valid one
+        const auto found = find_record(damaged + 1u);
+        if (!found.has_value()) { return false; }
+        if (found.value() < _log_size) {
+            header().log_size = found.value();
+            continue;
+        }
+
+        // the log ends with a torn or damaged record, the rest of it is dropped
+        if (ftruncate(_log_fd, static_cast<off_t>(damaged)) != 0) { return false; }
+        _log_size = damaged;
+        return true;
+    }
+    return true;
+}
+
+// indexes the records from the offset to the end of the log, returns false
+// at an invalid record (the covered length of the index stops before it)
+bool SolutionCache::index_records(uint64_t from) {
+    uint64_t offset = from;
+    while (offset < _log_size) {
+        uint64_t next = 0u;
+        const auto key = read_key(offset, next);
+        if (!key.has_value() || !insert_slot(key.value(), offset)) { return false; }
+        header().log_size = next;
+        offset = next;
+    }
+    return true;
+}
+
+bool SolutionCache::insert_slot(uint64_t key, uint64_t offset) {
+    if ((header().count + 1u) * 2u > header().capacity) {
+        vector<Slot> used;
+        copy_if(slots(), slots() + header().capacity, back_inserter(used),
+                [](const Slot & s){ return s.offset != 0u; });
+
+        // the new index covers only the log header until the slots are
+        // reinserted, so a crash in the middle of the growth reindexes the log
+        const uint64_t log_size = header().log_size;
+        if (!map_index(header().capacity * 2u, true)) { return false; }
+        for (const auto & s: used) { insert_slot(s.key, s.offset); }
+        header().log_size = log_size;
+    }
+
+    const size_t mask = header().capacity - 1u;
+    for (size_t i = key & mask; ; i = (i + 1u) & mask) {
+        Slot & slot = slots()[i];
+        if (slot.offset == 0u) {
+            slot.key    = key;
+            slot.offset = offset;
+            ++header().count;
+            return true;
+        }
+        // the newer record of the same level replaces the older one
+        if (slot.key == key) {
+            slot.offset = max(slot.offset, offset);
+            return true;
+        }
+    }
+}
+
+optional<string> SolutionCache::read_record(uint64_t offset, uint64_t & next) const {
+    RecordHeader rh;
+    if (_log_size - offset < sizeof(rh) || !read_exact(_log_fd, &rh, sizeof(rh), offset)) { return nullopt; }
+    if (rh.magic != RECORD_MAGIC || rh.size > MAX_RECORD) { return nullopt; }
+    if (_log_size - offset - sizeof(rh) < rh.size) { return nullopt; }
+
+    string payload(rh.size, '\0');
+    if (!read_exact(_log_fd, payload.data(), payload.size(), offset + sizeof(rh))) { return nullopt; }
+    if (fnv1a(payload.data(), payload.size()) != rh.checksum) { return nullopt; }
+
+    next = offset + sizeof(rh) + rh.size;
+    return payload;
+}
+
+optional<uint64_t> SolutionCache::read_key(uint64_t offset, uint64_t & next) const {
+    const auto payload = read_record(offset, next);
+    uint64_t key = 0u;
+    size_t pos = 0u;
+    if (!payload.has_value() || !extract(payload.value(), pos, key)) { return nullopt; }
+    return key;
+}
+
+// the offset of the first valid record at or after the offset, the size of the log
+// if there is none, nullopt if the log can't be read
+optional<uint64_t> SolutionCache::find_record(uint64_t from) const {
+    constexpr size_t CHUNK_SIZE = 1u << 16;
+    char magic[sizeof(RECORD_MAGIC)];
+    memcpy(magic, &RECORD_MAGIC, sizeof(magic));
+
+    // the chunks overlap, so the magic on the border of two chunks is found in the first one
+    string chunk;
+    for (uint64_t start = from; _log_size - min(start, _log_size) >= sizeof(magic); start += CHUNK_SIZE) {
+        chunk.resize(static_cast<size_t>(min<uint64_t>(CHUNK_SIZE + sizeof(magic) - 1u, _log_size - start)));
+        if (!read_exact(_log_fd, chunk.data(), chunk.size(), start)) { return nullopt; }
+
+        for (auto it = search(begin(chunk), end(chunk), begin(magic), end(magic)); it != end(chunk);
+                  it = search(next(it), end(chunk), begin(magic), end(magic))) {
+            const uint64_t offset = start + static_cast<uint64_t>(distance(begin(chunk), it));
+            uint64_t after = 0u;
+            if (read_key(offset, after).has_value()) { return offset; }
+        }
+    }
+    return _log_size;
+}
+
+optional<SolutionCache::Entry> SolutionCache::lookup(const vector<Tile> & maze,
+                                                      size_t width, size_t height) const {
+    const CanonicalLevel level(maze, width, height);
+
+    lock_guard<mutex> lock(_mutex);
+    const size_t mask = header().capacity - 1u;
+    for (size_t i = level.key() & mask; slots()[i].offset != 0u; i = (i + 1u) & mask) {
+        if (slots()[i].key != level.key()) { continue; }
+
+        uint64_t next = 0u;
+        const auto payload = read_record(slots()[i].offset, next);
+        if (!payload.has_value()) { return nullopt; }
+
+        uint64_t key = 0u;
+        uint32_t level_size = 0u, push_count = 0u;
+        size_t pos = 0u;
+        Entry entry;
+        if (!extract(payload.value(), pos, key) || !extract(payload.value(), pos, level_size)) { return nullopt; }
+        if (payload.value().size() - pos < level_size ||
+            payload.value().compare(pos, level_size, level.bytes()) != 0) { return nullopt; }
+        pos += level_size;
+
+        if (!extract(payload.value(), pos, entry.states) || !extract(payload.value(), pos, entry.search_ms) ||
+            !extract(payload.value(), pos, push_count)) { return nullopt; }
+        for (uint32_t p = 0; p < push_count; ++p) {
+            uint16_t from = 0u, to = 0u;
+            if (!extract(payload.value(), pos, from) || !extract(payload.value(), pos, to)) { return nullopt; }
+            entry.pushes.emplace_back(level.from_canonical(from), level.from_canonical(to));
+        }
+        return entry;
+    }
+    return nullopt;
+}
+
+bool SolutionCache::store(const vector<Tile> & maze, size_t width, size_t height, const Entry & entry) {
+    const CanonicalLevel level(maze, width, height);
+
+    string payload;
+    append(payload, level.key());
+    append(payload, static_cast<uint32_t>(level.bytes().size()));
+    payload += level.bytes();
+    append(payload, entry.states);
+    append(payload, entry.search_ms);
+    append(payload, static_cast<uint32_t>(entry.pushes.size()));
+    for (const auto & pi: entry.pushes) {
+        append(payload, static_cast<uint16_t>(level.to_canonical(pi.from())));
+        append(payload, static_cast<uint16_t>(level.to_canonical(pi.to())));
+    }
+    if (payload.size() > MAX_RECORD) { return false; }
+
+    const RecordHeader rh{ RECORD_MAGIC, static_cast<uint32_t>(payload.size()),
+                           fnv1a(payload.data(), payload.size()) };
+    string record;
+    append(record, rh);
+    record += payload;
+
+    lock_guard<mutex> lock(_mutex);
+    const uint64_t offset = _log_size;
+    // the record is durable before the index refers to it
+    if (!write_exact(_log_fd, record.data(), record.size(), offset) || fdatasync(_log_fd) != 0) {
+        return false;
+    }
+    _log_size += record.size();
+
+    // the record is found by the scan of the log on the next open otherwise
+    if (!insert_slot(level.key(), offset)) { return false; }
+    header().log_size = _log_size;
+    return true;
+}
+
+size_t SolutionCache::size() const {
+    lock_guard<mutex> lock(_mutex);
+    return header().count;
+}
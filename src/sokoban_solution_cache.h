@@ -0,0 +1,105 @@
+// Persistent store of found solutions, keyed by the canonical form of a level.
+//
+// The canonical level: the floor which the player can't reach becomes wall,
+// the level is cropped to the bounding box of its non-wall tiles, and of the
+// 8 symmetric variants (rotations and reflections) the least one by its bytes
+// is taken. The solutions are stored in the coordinates of the canonical
+// level and are translated back for the requested one, so all symmetric
+// variants of a level share one entry.
+//
+// Two files: <path>.log is the append-only log of the records, every record
+// has its checksum; <path>.idx is the memory-mapped open-addressing hash
+// table from the 64-bit hash of the canonical level to the record offset.
+// A record is appended and synced before it is indexed, and the index knows
+// the length of the log it covers. The index is derived data: on open the
+// records after the covered length are indexed, an inconsistent index is
+// rebuilt from the log, and a torn record at the end of the log (a crash in
+// the middle of a write) is truncated. Lookups verify the checksum and the
+// whole canonical level of the record, so neither hash collisions nor damaged
+// data give a wrong solution. The files are locked by one process at a time.
+
+#ifndef SOKOBAN_SOLUTION_CACHE_H
+#define SOKOBAN_SOLUTION_CACHE_H
+
+#include "sokoban_common.h"
+#include "sokoban_pushinfo.h"
+#include "sokoban_level_symmetry.h"
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <optional>
+#include <mutex>
+#include <cstdint>
+
+namespace Sokoban
+{
+// The canonical form of a level and the mapping of its tiles
+class CanonicalLevel {
+    std::string _bytes;         // width, height (16 bits each) and the tiles
+    std::uint64_t _key = 0u;
+    size_t _width = 0u;         // of the original level
+    size_t _left = 0u, _top = 0u;
+    RectangleSymmetry _symmetry{ 0u, 0u, 0u };  // of the cropped level to the canonical one
+
+public:
+    CanonicalLevel(const std::vector<Tile> & maze, size_t width, size_t height);
+
+    const std::string & bytes() const { return _bytes; }
+    std::uint64_t key() const { return _key; }
+
+    // the index of the canonical level for the index of the original level and back
+    index_t to_canonical(index_t index) const;
+    index_t from_canonical(index_t index) const;
+};
+
+class SolutionCache {
+public:
+    struct Entry {
+        std::vector<PushInfo> pushes;
+        std::uint64_t states = 0u;      // the statistics of the search which found the solution
+        std::uint64_t search_ms = 0u;
+    };
+
+private:
+    struct IndexHeader;
+    struct Slot;
+
+    std::string _log_path, _index_path;
+    int _log_fd = -1, _index_fd = -1;
+    std::uint64_t _log_size = 0u;
+    void * _index = nullptr;
+    size_t _index_size = 0u;
+    mutable std::mutex _mutex;
+
+    IndexHeader & header() const;
+    Slot * slots() const;
+
+    bool map_index(size_t capacity, bool create);
+    bool rebuild_index(size_t capacity);
+    bool index_records(std::uint64_t from);
+    bool insert_slot(std::uint64_t key, std::uint64_t offset);
+    std::optional<std::string> read_record(std::uint64_t offset, std::uint64_t & next) const;
+    std::optional<std::uint64_t> read_key(std::uint64_t offset, std::uint64_t & next) const;
+    std::optional<std::uint64_t> find_record(std::uint64_t from) const;
+
+    SolutionCache() = default;
+
+public:
+    ~SolutionCache();
+    SolutionCache(const SolutionCache &) = delete;
+    SolutionCache & operator=(const SolutionCache &) = delete;
+
+    // Opens or creates the cache, returns nullptr if the files can't be used
+    // or are locked by another process
+    static std::unique_ptr<SolutionCache> open(const std::string & path);
+
+    std::optional<Entry> lookup(const std::vector<Tile> & maze, size_t width, size_t height) const;
+    // returns false on i/o errors
+    bool store(const std::vector<Tile> & maze, size_t width, size_t height, const Entry & entry);
+
+    size_t size() const;
+};
+}
+
+#endif
@@ -0,0 +1,185 @@
+#include "sokoban_solution_optimizer.h"
+#include "sokoban_board.h"
+#include "thread_pool.h"
+
+#include <unordered_map>
+#include <algorithm>
+#include <memory>
+#include <future>
+#include <bitset>
+
+using namespace Sokoban;
+using namespace std;
+
+bool SolutionOptimizer::initialize_board(Board & board) const {
+    return board.initialize(vector<Tile>(_maze), _width, _height);
+}
+
+optional<vector<BoxState>> SolutionOptimizer::replay(Board & board, const BoxState & base,
+                                                     const vector<PushInfo> & solution) const {
+    vector<BoxState> states{ base };
+
+    for (const auto & pi: solution) {
+        board.set_boxstate(states.back());
+        if (!board.is_push_legal(pi)) { return nullopt; }
+
+        board.set_boxstate_and_push(states.back(), pi);
+        states.push_back(board.current_state());
+    }
+
+    if (!board.is_complete()) { return nullopt; }
+    return states;
+}
+
+// the breadth-first search from the first state of the window, the shortcut
+// leads to the state of the window with the largest saving
+optional<SolutionOptimizer::Shortcut> SolutionOptimizer::find_shortcut(Board & board,
+                const vector<BoxState> & states, size_t first, size_t last,
+                const Options & options) const {
+    struct Node {
+        BoxState state;
+        size_t parent;
+        PushInfo push;
+        size_t depth;
+    };
+
+    unordered_map<BoxState, size_t, BoxStateHash> targets(0u, BoxStateHash{ &_context });
+    for (size_t k = first + 1; k <= last; ++k) { targets[states[k]] = k; }
+
+    // only the boxes moved within the window are pushed, the detours of greedy
+    // solutions are local, and the search stays narrow
+    bitset<MAX_BOX_COUNT> movable;
+    for (size_t k = first + 1; k <= last; ++k) {
+        for (size_t bi = 0; bi < _context.box_count; ++bi) {
+            if (states[k].box_indexes[bi] != states[first].box_indexes[bi]) { movable[bi] = true; }
+        }
+    }
+    auto is_movable = [&movable, this](const BoxState & state, index_t from) {
+        const auto first_box = begin(state.box_indexes);
+        const auto it = find(first_box, first_box + _context.box_count, from);
+        return movable[static_cast<size_t>(distance(first_box, it))];
+    };
+
+    unordered_map<BoxState, size_t, BoxStateHash> visited(0u, BoxStateHash{ &_context });
+    vector<Node> nodes{ { states[first], 0u, { 0u, 0u }, 0u } };
+    visited.emplace(states[first], 0u);
+
+    optional<pair<size_t, size_t>> best;  // the node and the index of the reached state
+    size_t best_saving = 0u;
+
+    for (size_t ni = 0; ni < nodes.size(); ++ni) {
+        // the deeper nodes can't save more than the best found shortcut
+        const size_t depth = nodes[ni].depth + 1;
+        if (depth + best_saving >= last - first) { break; }
+
+        const BoxState state = nodes[ni].state;
+        board.set_boxstate(state);
+        const auto pushes = board.possible_pushes();
+
+        for (const auto & push: pushes) {
+            const PushInfo & pi = push.first;
+            if (!is_movable(state, pi.from())) { continue; }
+
+            board.set_boxstate_and_push(state, pi);
+            const BoxState next = board.current_state();
+
+            if (!visited.emplace(next, nodes.size()).second) { continue; }
+            nodes.push_back({ next, ni, pi, depth });
+
+            const auto it = targets.find(next);
+            if (it != targets.end() && it->second > first + depth
+                                    && it->second - first - depth > best_saving) {
+                best_saving = it->second - first - depth;
+                best = { nodes.size() - 1, it->second };
+            }
+        }
+
+        if (nodes.size() >= options.max_states) { break; }
+    }
+
+    if (!best.has_value()) { return nullopt; }
+
+    Shortcut result{ first, best->second, {} };
+    for (size_t ni = best->first; ni != 0u; ni = nodes[ni].parent) {
+        result.pushes.push_back(nodes[ni].push);
+    }
+    reverse(begin(result.pushes), end(result.pushes));
+    return result;
+}
+
+vector<PushInfo> SolutionOptimizer::optimize(const vector<PushInfo> & solution,
+                                             const Options & options) const {
+    Board board;
+    if (!initialize_board(board) || solution.size() < 2u) { return solution; }
+    const BoxState base = board.current_state();
+
+    const size_t window = max<size_t>(options.window, 2u);
+    const size_t step   = window / 2;
+    const size_t thread_count = max<size_t>(options.threads, 1u);
+    ThreadPool pool(thread_count > 1u ? thread_count : 0u);
+
+    // every thread has its own board for all passes, the first thread shares
+    // the board of the replays, which don't run during the searches
+    vector<unique_ptr<Board>> locals;
+    vector<Board *> boards{ &board };
+    for (size_t t = 1; t < thread_count; ++t) {
+        locals.push_back(make_unique<Board>());
+        if (!initialize_board(*locals.back())) { return solution; }
+        boards.push_back(locals.back().get());
+    }
+
+    vector<PushInfo> result = solution;
+    for (size_t pass = 0; pass < options.max_passes; ++pass) {
+        const auto states = replay(board, base, result);
+        if (!states.has_value()) { return solution; }
+
+        vector<size_t> firsts;
+        for (size_t first = 0; first + 1 < result.size(); first += step) { firsts.push_back(first); }
+
+        // every thread searches its share of the windows on its own board
+        vector<optional<Shortcut>> shortcuts(firsts.size());
+        vector<future<void>> done;
+        for (size_t t = 0; t < thread_count; ++t) {
+            done.push_back(pool.submit([&, t]{
+                for (size_t wi = t; wi < firsts.size(); wi += thread_count) {
+                    const size_t last = min(firsts[wi] + window, result.size());
+                    shortcuts[wi] = find_shortcut(*boards[t], states.value(), firsts[wi], last, options);
+                }
+            }));
+        }
+        for (auto & d: done) { d.get(); }
+
+        // the largest shortcuts are applied first, overlapping ones are skipped
+        vector<Shortcut> applied;
+        for (auto & sc: shortcuts) {
+            if (sc.has_value()) { applied.push_back(move(sc.value())); }
+        }
+        stable_sort(begin(applied), end(applied), [](const auto & l, const auto & r){
+            return l.saving() > r.saving(); });
+
+        vector<Shortcut> chosen;
+        for (auto & sc: applied) {
+            const bool overlaps = any_of(begin(chosen), end(chosen), [&sc](const auto & c){
+                return sc.first < c.last && c.first < sc.last; });
+            if (!overlaps) { chosen.push_back(move(sc)); }
+        }
+        if (chosen.empty()) { break; }
+
+        sort(begin(chosen), end(chosen), [](const auto & l, const auto & r){
+            return l.first < r.first; });
+
+        vector<PushInfo> shortened;
+        size_t pos = 0u;
+        for (const auto & sc: chosen) {
+            shortened.insert(end(shortened), begin(result) + pos, begin(result) + sc.first);
+            shortened.insert(end(shortened), begin(sc.pushes), end(sc.pushes));
+            pos = sc.last;
+        }
+        shortened.insert(end(shortened), begin(result) + pos, end(result));
+        result = move(shortened);
+    }
+
+    // the shortcuts are checked by the replay of the whole solution
+    if (!replay(board, base, result).has_value()) { return solution; }
+    return result;
+}
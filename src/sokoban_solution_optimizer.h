@@ -0,0 +1,65 @@
+#ifndef SOKOBAN_SOLUTION_OPTIMIZER_H
+#define SOKOBAN_SOLUTION_OPTIMIZER_H
+
+#include "sokoban_common.h"
+#include "sokoban_boxstate.h"
+#include "sokoban_pushinfo.h"
+#include "sokoban_solver_context.h"
+
+#include <vector>
+#include <optional>
+
+namespace Sokoban
+{
+class Board;
+
+// The parameters of the solution optimization
+struct OptimizerOptions {
+    size_t window     = 24;      // the number of pushes in a window
+    size_t max_states = 10000;   // the limit of the search in one window
+    size_t max_passes = 8;
+    size_t threads    = 0;       // 0 - in the calling thread
+};
+
+// Shortens a found solution by local searches. The solution is replayed to get
+// all intermediate states, then for every window of the solution the bounded
+// breadth-first search from the first state of the window (pushing only the
+// boxes moved within the window) looks for any later state of the window
+// reachable by less pushes. The windows overlap by half, the found shortcuts
+// which don't overlap are applied, and the passes are repeated while the
+// solution gets shorter. Windows are independent and are searched in parallel,
+// every thread has its own board.
+class SolutionOptimizer {
+public:
+    using Options = OptimizerOptions;
+
+private:
+    struct Shortcut {
+        size_t first, last;          // the replaced pushes [first, last)
+        std::vector<PushInfo> pushes;
+
+        size_t saving() const { return last - first - pushes.size(); }
+    };
+
+    const std::vector<Tile> & _maze;
+    size_t _width, _height;
+    const SolverContext & _context;
+
+    bool initialize_board(Board & board) const;
+    std::optional<std::vector<BoxState>> replay(Board & board, const BoxState & base,
+                                                const std::vector<PushInfo> & solution) const;
+    std::optional<Shortcut> find_shortcut(Board & board, const std::vector<BoxState> & states,
+                                          size_t first, size_t last, const Options & options) const;
+
+public:
+    SolutionOptimizer(const std::vector<Tile> & maze, size_t width, size_t height,
+                      const SolverContext & context)
+        : _maze{ maze }, _width{ width }, _height{ height }, _context{ context } { }
+
+    // returns the shortened solution, or the same solution if it can't be replayed
+    std::vector<PushInfo> optimize(const std::vector<PushInfo> & solution,
+                                   const Options & options = {}) const;
+};
+}
+
+#endif
@@ -1,18 +1,44 @@
 #include "sokoban_solver.h"
 #include "sokoban_formatter.h"
+#include "sokoban_move_reconstruction.h"
 
 #include "sokoban_pushinfo.h"
 #include "string_join.h"
-#include "stable_priority_queue.h"
 
 #include <iterator>
 #include <iostream>
 #include <string>
+#include <algorithm>
+#include <limits>
 
 using namespace std;
 using namespace Sokoban;
 
+void Solver::set_preprocess_threads(size_t count) {
+    _pool = count > 0 ? make_unique<ThreadPool>(count) : nullptr;
+}
+
+void Solver::reset() {
+    _trans_table.clear();
+    if (_bitstate) { _bitstate->clear(); }
+    _trans_graph.clear();
+    _queue.clear();
+    _compact_queue.clear();
+    _solution.reset();
+    _optimal = false;
+    _cached_states.reset();
+    _search_states.reset();
+    _resumed = false;
+    _stop_reason = StopReason::None;
+}
+
+void Solver::set_hash_seed(uint64_t seed) {
+    _context.zhash = SolverContext::zobrist_t{ seed };
+}
+
 bool Solver::read_level_data(std::istream & stream) {
+    reset();
+
     string line;
     vector<Tile> maze;
     maze.reserve(MAX_TILE_COUNT);
@@ -21,6 +47,7 @@ bool Solver::read_level_data(std::istream & stream) {
     while(getline(stream, line) && !line.empty()) {
         if (width == 0) { width = static_cast<unsigned short>(line.length()); }
         else if (width != line.length()) { return false; }
+        if (maze.size() + line.length() > MAX_TILE_COUNT) { return false; }
 
         for (const auto ch: line) {
             const auto tile = Formatter::encode(ch);
@@ -30,7 +57,10 @@ bool Solver::read_level_data(std::istream & stream) {
         height++;
     }
 
-    return _board.initialize(move(maze), width, height);
+    _maze   = maze;
+    _width  = width;
+    _height = height;
+    return _board.initialize(move(maze), width, height, _pool.get());
 }
 
 void Solver::print_information() const {
@@ -42,22 +72,28 @@ void Solver::print_solution_format1(std::ostream & stream) {
     /* _trans_graph.print(cout); */
     /* _trans_table.print(); */
 
-    cout << "Solution (" << _trans_table.size() << " states):" << endl;
-    auto path = _trans_graph.get_path();
-    if (path.has_value()) {
-        stream << string_join(path.value(), " ") << endl;
+    if (_cached_states.has_value()) {
+        cout << "Solution (from cache, " << _cached_states.value() << " states):" << endl;
+    } else if (_search_states.has_value()) {
+        cout << "Solution (" << _search_name << ", " << _search_states.value() << " states):" << endl;
+    } else {
+        cout << "Solution (" << state_count() << " states, hash seed "
+             << hash_seed() << "):" << endl;
+    }
+    if (_solution.has_value()) {
+        stream << string_join(_solution.value(), " ") << endl;
     }
 }
 
 void Solver::print_solution_format2(std::ostream & stream) {
-    cout << "Solution (" << _trans_table.size() << " states):" << endl;
-    auto path = _trans_graph.get_path();
-    if (path.has_value()) {
+    cout << "Solution (" << state_count() << " states, hash seed "
+         << hash_seed() << "):" << endl;
+    if (_solution.has_value()) {
         _board.set_boxstate(_base_state);
         _board.print_state();
 
-        for (size_t i = 0; i < path.value().size(); ++i) {
-            const PushInfo & pi = path.value()[i];
+        for (size_t i = 0; i < _solution.value().size(); ++i) {
+            const PushInfo & pi = _solution.value()[i];
             _board.set_boxstate_and_push(_board.current_state(), pi);
 
             stream << pi << '\n';
@@ -71,28 +107,126 @@ size_t Solver::max_priority() const {
 }
 
 size_t Solver::calculate_priority(const Board::StateStats & stats) const {
-    /* size_t bos = stats.boxes_on_goals_count; */
+    size_t bos = stats.boxes_on_goals_count;
     size_t ord_bos = stats.ordered_boxes_on_goals_count;
+    if (_greedy_priority == GreedyPriority::GoalOrder) { return ord_bos; }
+
     size_t priority = 0u;
     if      (stats.push_distances.first > stats.push_distances.second) { priority = 2u; }
     else if (stats.push_distances.first < stats.push_distances.second) { priority = 0u; }
     else { priority = 1u; }
-    return priority + ord_bos;
+    return priority + (_greedy_priority == GreedyPriority::Distance ? bos : ord_bos);
+}
+
+void Solver::set_bitstate(size_t bytes, size_t hash_count) {
+    _bitstate = bytes > 0u ? make_unique<BitstateTable>(_context, bytes, hash_count) : nullptr;
+}
+
+optional<BitstateStats> Solver::bitstate_stats() const {
+    if (!_bitstate) { return nullopt; }
+    return BitstateStats{ _bitstate->memory_bytes(), memory_usage(), _bitstate->size(),
+                          _bitstate->omission_probability(), _bitstate->expected_omissions() };
 }
 
 bool Solver::solve() {
+    return search_greedy({}, _prune_symmetries, _bitstate.get());
+}
+
+bool Solver::solve(const SearchLimits & limits) {
+    return search_greedy(limits, _prune_symmetries, _bitstate.get());
+}
+
+bool Solver::search_greedy(const SearchLimits & limits, bool prune_symmetries, BitstateTable * bitstate) {
     assert(_board.box_count() <= MAX_BOX_COUNT);
-    BoxState::set_box_count(_board.box_count());
-    if (_board.is_complete()) { return true; }
+    _context.box_count = _board.box_count();
+    _cached_states.reset();
+    _search_states.reset();
+    _expanded = 0u;
+    if (_board.is_complete()) {
+        _solution.emplace();
+        _stop_reason = StopReason::Solved;
+        return true;
+    }
 
-    StablePriorityQueue<pair<stateid_t, BoxState>> q(max_priority() + 1);
-    _base_state = _board.current_state();
-    auto [inserted, base_state_id] = _trans_table.insert_state(_base_state);
-    q.push(0u, {base_state_id, _base_state});
+    auto & q = _queue;
+    // the bitstate search keeps only the ids of the open states, the states are
+    // rebuilt from the pushes of their paths in the graph
+    auto & compact_q = _compact_queue;
+    auto queue_push = [&q, &compact_q, bitstate](size_t priority, stateid_t id, const BoxState & state) {
+        if (bitstate != nullptr) { compact_q.push(priority, id); }
+        else                     { q.push(priority, { id, state }); }
+    };
+    auto queue_empty = [&q, &compact_q, bitstate] {
+        return bitstate != nullptr ? compact_q.empty() : q.empty();
+    };
+    auto queue_size = [&q, &compact_q, bitstate] {
+        return bitstate != nullptr ? compact_q.size() : q.size();
+    };
+    auto queue_pop = [this, &q, &compact_q, bitstate] {
+        if (bitstate == nullptr) {
+            auto result = q.front();
+            q.pop();
+            return result;
+        }
+        const stateid_t id = compact_q.front();
+        compact_q.pop();
+        return pair{ id, rebuild_state(id) };
+    };
+
+    // the keys of the table are the representatives of the symmetric states
+    const bool symmetric = prune_symmetries && _board.symmetry_count() > 0u;
+    auto current_state = [this, symmetric] {
+        return symmetric ? _board.current_state_and_key()
+                         : pair{ _board.current_state(), BoxState{} };
+    };
+    auto insert_state = [this, bitstate](const BoxState & state) {
+        return bitstate != nullptr ? bitstate->insert_state(state) : _trans_table.insert_state(state);
+    };
+    auto stored_count = [this, bitstate] {
+        return bitstate != nullptr ? bitstate->size() : _trans_table.size();
+    };
+
+    // the resumed search has its tables and open list from the snapshot
+    if (!_resumed) {
+        q.reset(max_priority() + 1);
+        compact_q.reset(max_priority() + 1);
+
+        BoxState base_key;
+        tie(_base_state, base_key) = current_state();
+        auto [inserted, base_state_id] = insert_state(symmetric ? base_key : _base_state);
+        queue_push(0u, base_state_id, _base_state);
+    }
+    _resumed = false;
+
+    auto next_checkpoint = chrono::steady_clock::now() + _checkpoint.interval;
+
+    // the limits are checked by the countdown of the expansions
+    const size_t check_period = max<size_t>(1u, limits.check_period);
+    size_t until_check = check_period;
+    auto stop = [this](StopReason reason) {
+        _stop_reason = reason;
+        return false;
+    };
 
-    while (!q.empty()) {
-        auto [state_id, state] = q.front();
-        q.pop();
+    for (size_t expanded = 1; !queue_empty(); ++expanded) {
+        _expanded = expanded;
+        if (--until_check == 0u) {
+            until_check = check_period;
+
+            const auto reason = check_limits(limits, expanded, stored_count(), queue_size(), 0u);
+            if (reason.has_value()) { return stop(reason.value()); }
+
+            const auto now = chrono::steady_clock::now();
+            if (!_checkpoint.path.empty() && bitstate == nullptr && now >= next_checkpoint) {
+                CheckpointStats stats;
+                if (write_checkpoint(_checkpoint.path, stats) && _checkpoint.on_checkpoint) {
+                    _checkpoint.on_checkpoint(stats);
+                }
+                next_checkpoint = chrono::steady_clock::now() + _checkpoint.interval;
+            }
+        }
+
+        auto [state_id, state] = queue_pop();
 
         _board.set_boxstate(state);
         auto pushes = _board.possible_pushes();
@@ -100,18 +234,301 @@ bool Solver::solve() {
         for (const auto [pushinfo, stats]: pushes) {
             _board.set_boxstate_and_push(state, pushinfo);
 
-            auto new_state = _board.current_state();
-            auto [inserted, new_state_id] = _trans_table.insert_state(new_state);
+            auto [new_state, key] = current_state();
+            auto [inserted, new_state_id] = insert_state(symmetric ? key : new_state);
 
             if (inserted) {
                 _trans_graph.insert_state(state_id, new_state_id, pushinfo);
 
                 size_t priority = calculate_priority(stats);
-                q.push(priority, {new_state_id, new_state});
-                if (_board.is_complete()) { return true; }
+                queue_push(priority, new_state_id, new_state);
+                if (_board.is_complete()) {
+                    _solution = _trans_graph.get_path();
+                    _stop_reason = StopReason::Solved;
+                    return true;
+                }
             };
         }
     }
-    return false;
+    return stop(StopReason::Exhausted);
+}
+
+BoxState Solver::rebuild_state(stateid_t state_id) {
+    if (state_id == 0u) { return _base_state; }
+
+    // the boxes keep their identities, the player stands where the last pushed box was
+    const index_t player = _trans_graph.push(state_id).from();
+    auto & path = _rebuild_path;
+    path.clear();
+    for (; state_id != 0u; state_id = _trans_graph.parent(state_id)) { path.push_back(_trans_graph.push(state_id)); }
+
+    array<index_t, MAX_BOX_COUNT> boxes = _base_state.box_indexes;
+    const auto last = begin(boxes) + static_cast<ptrdiff_t>(_board.box_count());
+    for (auto it = path.rbegin(); it != path.rend(); ++it) {
+        *find(begin(boxes), last, it->from()) = it->to();
+    }
+    return _board.make_state(boxes.data(), player);
+}
+
+optional<StopReason> Solver::check_limits(const SearchLimits & limits, size_t expanded, size_t stored,
+                                          size_t frontier, size_t frontier_bytes) const {
+    const size_t memory = limits.on_progress || limits.max_memory != 0u ? memory_usage() + frontier_bytes : 0u;
+    if (limits.on_progress) { limits.on_progress({ expanded, stored, frontier, memory }); }
+    if (limits.cancel != nullptr && limits.cancel->load(memory_order_relaxed)) { return StopReason::Cancelled; }
+    if (limits.max_states != 0u && stored >= limits.max_states)       { return StopReason::StateLimit; }
+    if (limits.max_expanded != 0u && expanded >= limits.max_expanded) { return StopReason::ExpansionLimit; }
+    if (limits.max_memory != 0u && memory >= limits.max_memory)       { return StopReason::MemoryLimit; }
+    if (chrono::steady_clock::now() >= limits.deadline)               { return StopReason::Deadline; }
+    return nullopt;
+}
+
+size_t Solver::memory_usage() const {
+    const size_t closed_set = _bitstate ? _bitstate->memory_bytes() : _trans_table.memory_bytes();
+    return closed_set + _trans_graph.memory_bytes()
+         + _queue.size() * sizeof(pair<stateid_t, BoxState>) + _compact_queue.size() * sizeof(stateid_t);
+}
+
+// The first solution is found by the greedy search (the weight is infinite),
+// then weighted A* (Anytime Weighted A*) continues from all states of the
+// greedy search with their path lengths, which are upper bounds of their costs
+bool Solver::solve_anytime(const AnytimeOptions & options, const SolutionCallback & on_solution,
+                           const SearchLimits & search_limits) {
+    using clock = chrono::steady_clock;
+
+    _solution.reset();
+    _optimal = false;
+
+    // the limits are shared by both searches, the budget is one more deadline
+    SearchLimits limits = search_limits;
+    if (options.time_budget.count() > 0) {
+        limits.deadline = min(limits.deadline, clock::now() + options.time_budget);
+    }
+    // the weighted search is seeded from the states of the table, they must be actual
+    if (!search_greedy(limits, false, nullptr)) { return false; }
+    if (_solution.value().empty()) {
+        _optimal = true;
+        return true;
+    }
+    if (on_solution) { on_solution(_solution.value(), numeric_limits<double>::infinity()); }
+
+    struct Node {
+        double f;
+        size_t h;
+        size_t order;
+        stateid_t id;
+        size_t g;
+        BoxState state;
+    };
+    // the heap top is the least f, then the least estimate, then the oldest node
+    auto worse = [](const Node & l, const Node & r) {
+        if (l.f != r.f) { return l.f > r.f; }
+        if (l.h != r.h) { return l.h > r.h; }
+        return l.order > r.order;
+    };
+
+    size_t best = _solution.value().size();
+    double weight = max(1.0, options.initial_weight);
+    auto priority = [&weight](size_t g, size_t h) {
+        return static_cast<double>(g) + weight * static_cast<double>(h);
+    };
+
+    // the least known number of pushes to every state, a parent is always
+    // inserted before its children
+    vector<size_t> costs(_trans_table.size(), 0u);
+    for (stateid_t id = 1; id < costs.size(); ++id) {
+        costs[id] = costs[_trans_graph.parent(id)] + 1;
+    }
+
+    vector<Node> open;
+    _trans_table.for_each([&](const BoxState & state) {
+        _board.set_boxstate(state);
+        const size_t g = costs[state.unique_index];
+        const size_t h = _board.push_lower_bound();
+        if (h != BoardGraphs::UNREACHABLE && g + h < best) {
+            open.push_back({ priority(g, h), h, state.unique_index, state.unique_index, g, state });
+        }
+    });
+    make_heap(begin(open), end(open), worse);
+    size_t order = costs.size();
+
+    // the countdown continues the one of the greedy search
+    const size_t check_period = max<size_t>(1u, limits.check_period);
+    size_t until_check = check_period - _expanded % check_period;
+    for (size_t expanded = _expanded + 1; !open.empty(); ++expanded) {
+        _expanded = expanded;
+        if (--until_check == 0u) {
+            until_check = check_period;
+
+            const auto reason = check_limits(limits, expanded, _trans_table.size(), open.size(),
+                                             open.capacity() * sizeof(Node) + costs.capacity() * sizeof(size_t));
+            // the found solution stays, it isn't proven optimal
+            if (reason.has_value()) {
+                _stop_reason = reason.value();
+                return true;
+            }
+        }
+
+        pop_heap(begin(open), end(open), worse);
+        const Node node = move(open.back());
+        open.pop_back();
+
+        // the node is outdated by a shorter path or can't improve the solution
+        if (node.g > costs[node.id] || node.g + node.h >= best) { continue; }
+
+        _board.set_boxstate(node.state);
+        auto pushes = _board.possible_pushes();
+
+        for (const auto & [pushinfo, stats]: pushes) {
+            _board.set_boxstate_and_push(node.state, pushinfo);
+
+            const size_t g = node.g + 1;
+            const size_t h = _board.push_lower_bound();
+            if (h == BoardGraphs::UNREACHABLE || g + h >= best) { continue; }
+
+            auto new_state = _board.current_state();
+            auto [inserted, new_state_id] = _trans_table.insert_state(new_state);
+
+            if (inserted) {
+                _trans_graph.insert_state(node.id, new_state_id, pushinfo);
+                costs.push_back(g);
+            } else if (g < costs[new_state_id]) {
+                _trans_graph.update_state(node.id, new_state_id, pushinfo);
+                costs[new_state_id] = g;
+            } else {
+                continue;
+            }
+
+            if (!_board.is_complete()) {
+                open.push_back({ priority(g, h), h, order++, new_state_id, g, new_state });
+                push_heap(begin(open), end(open), worse);
+                continue;
+            }
+
+            best = g;
+            _solution = _trans_graph.get_path(new_state_id);
+            if (on_solution) { on_solution(_solution.value(), weight); }
+
+            // the rest of the search is ordered by the lower weight
+            weight = 1.0 + (weight - 1.0) * options.weight_decay;
+            for (auto & n: open) { n.f = priority(n.g, n.h); }
+            make_heap(begin(open), end(open), worse);
+        }
+    }
+
+    // all states which could lead to a shorter solution are exhausted
+    _optimal = true;
+    _stop_reason = StopReason::Solved;
+    return true;
+}
+
+size_t Solver::optimize_solution(const OptimizerOptions & options) {
+    if (!_solution.has_value()) { return 0u; }
+
+    // the search is finished, so the context is used only for hashing
+    const SolutionOptimizer optimizer(_maze, _width, _height, _context);
+    const auto shortened = optimizer.optimize(_solution.value(), options);
+
+    const size_t removed = _solution.value().size() - shortened.size();
+    _solution = shortened;
+    _optimal  = _optimal && removed == 0u;
+    return removed;
+}
+
+bool Solver::solve_external(const ExternalSearchOptions & options) {
+    _solution.reset();
+    _optimal = false;
+    _cached_states.reset();
+    _base_state = _board.current_state();
+
+    // the number of states is the size of the last closed set
+    ExternalSearchOptions search_options = options;
+    uint64_t states = 1u;
+    search_options.on_layer = [&options, &states](size_t depth, uint64_t layer_size, uint64_t closed_size) {
+        states = closed_size;
+        if (options.on_layer) { options.on_layer(depth, layer_size, closed_size); }
+    };
+
+    ExternalSearch search(_board, search_options);
+    _solution = search.solve();
+    _search_states = states;
+    _search_name = "external";
+    _optimal = _solution.has_value();
+    switch (search.status()) {
+        case ExternalStatus::Solved:     _stop_reason = StopReason::Solved;     break;
+        case ExternalStatus::Unsolvable: _stop_reason = StopReason::Exhausted;  break;
+        case ExternalStatus::DepthLimit: _stop_reason = StopReason::DepthLimit; break;
+        case ExternalStatus::IoError:    _stop_reason = StopReason::IoError;    break;
+    }
+    return _optimal;
+}
+
+bool Solver::solve_beam(const BeamOptions & options) {
+    _solution.reset();
+    _optimal = false;
+    _cached_states.reset();
+    _context.box_count = _board.box_count();
+    _base_state = _board.current_state();
+
+    BeamSearch search(_board, _context, options);
+    _solution = search.solve();
+    _search_states = search.state_count();
+    _search_name = "beam";
+
+    // the beam without pruning is the exhaustive breadth-first search
+    const bool cancelled = options.cancel != nullptr && options.cancel->load(memory_order_relaxed);
+    _stop_reason = _solution.has_value() ? StopReason::Solved
+                 : cancelled             ? StopReason::Cancelled
+                 : search.depth_limited() ? StopReason::DepthLimit
+                 : search.pruned()        ? StopReason::StateLimit
+                                          : StopReason::Exhausted;
+    return _solution.has_value();
+}
+
+bool Solver::load_solution(const SolutionCache & cache) {
+    // the reason of the previous search is stale in either case
+    _stop_reason = StopReason::None;
+    const auto entry = cache.lookup(_maze, _width, _height);
+    if (!entry.has_value()) { return false; }
+
+    _context.box_count = _board.box_count();
+    _base_state = _board.current_state();
+    // a rejected solution leaves the board in the initial state for the search
+    auto reject = [this] {
+        _board.set_boxstate(_base_state);
+        return false;
+    };
+
+    BoxState state = _base_state;
+    for (const auto & pi: entry.value().pushes) {
+        _board.set_boxstate(state);
+        if (!_board.is_push_legal(pi)) { return reject(); }
+
+        _board.set_boxstate_and_push(state, pi);
+        state = _board.current_state();
+    }
+    if (!_board.is_complete()) { return reject(); }
+
+    _solution = entry.value().pushes;
+    _optimal  = false;
+    _cached_states = entry.value().states;
+    _search_states.reset();
+    _stop_reason = StopReason::Solved;
+    return true;
+}
+
+bool Solver::store_solution(SolutionCache & cache, chrono::milliseconds search_time) const {
+    if (!_solution.has_value()) { return false; }
+
+    SolutionCache::Entry entry;
+    entry.pushes    = _solution.value();
+    entry.states    = _cached_states.value_or(_search_states.value_or(state_count()));
+    entry.search_ms = static_cast<uint64_t>(search_time.count());
+    return cache.store(_maze, _width, _height, entry);
 }
 
+optional<string> Solver::solution_moves() const {
+    if (!_solution.has_value()) { return nullopt; }
+
+    MoveReconstructor reconstructor(_maze, _width);
+    return reconstructor.moves(_solution.value());
+}
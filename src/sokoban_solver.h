@@ -2,33 +2,236 @@
 #define SOKOBAN_SOLVER_H
 
 #include <iosfwd>
+#include <memory>
+#include <optional>
+#include <functional>
+#include <chrono>
+#include <string>
+#include <atomic>
 #include "sokoban_board.h"
+#include "sokoban_solver_context.h"
+#include "sokoban_solution_optimizer.h"
+#include "sokoban_solution_cache.h"
+#include "sokoban_external_search.h"
+#include "sokoban_beam_search.h"
 #include "sokoban_transposition_table.h"
+#include "sokoban_bitstate_table.h"
 #include "sokoban_transposition_graph.h"
+#include "thread_pool.h"
+#include "stable_priority_queue.h"
 
 namespace Sokoban
 {
+// The ranking of the states in the greedy search, the higher priority is expanded first
+enum class GreedyPriority {
+    Combined,       // the push distances of the last pushed box and the boxes on goals in their order
+    GoalOrder,      // only the boxes on goals in their order
+    Distance,       // the push distances of the last pushed box and the boxes on any goals
+};
+
+// The parameters of the anytime search
+struct AnytimeOptions {
+    double initial_weight = 5.0;            // the weight of the estimate for the first solution
+    double weight_decay   = 0.5;            // (weight - 1) is multiplied by it after every solution
+    std::chrono::milliseconds time_budget{ 0 };  // 0 - until the optimum is proven
+};
+
+// The state of the running search passed to the progress callback
+struct SearchProgress {
+    size_t expanded = 0u;       // the expanded states
+    size_t stored = 0u;         // the states of the closed set
+    size_t frontier = 0u;       // the states of the open list
+    size_t memory_bytes = 0u;   // the estimated memory of the tables and the open list
+};
+
+// Why the last search stopped
+enum class StopReason {
+    None,           // no search yet
+    Solved,
+    Exhausted,      // the open list is empty, the level is unsolvable
+    Cancelled,
+    Deadline,
+    StateLimit,
+    ExpansionLimit,
+    MemoryLimit,
+    DepthLimit,     // of the external search
+    IoError,        // the external search can't write or read its files
+};
+
+// The limits of one search and its monitoring. All of them are checked
+// every check_period expansions only, so they cost nothing in the inner loop;
+// a limit may be exceeded by the states of check_period expansions
+struct SearchLimits {
+    const std::atomic<bool> * cancel = nullptr;  // the search stops when the flag is set
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+    size_t max_states = 0u;                      // of the closed set, 0 - unlimited
+    size_t max_expanded = 0u;                    // 0 - unlimited
+    size_t max_memory = 0u;                      // in bytes (see SearchProgress), 0 - unlimited
+    size_t check_period = 1024u;
+    std::function<void(const SearchProgress &)> on_progress;
+};
+
+// The state of the closed set of the bitstate search
+struct BitstateStats {
+    size_t memory_bytes = 0u;           // of the filter
+    size_t search_memory_bytes = 0u;    // the filter, the graph of the parents and the open list
+    size_t states = 0u;
+    double omission_probability = 0.0;  // of the next new state
+    double expected_omissions = 0.0;    // the estimated number of the omitted states
+};
+
+// The statistics of one written snapshot of the search
+struct CheckpointStats {
+    size_t bytes    = 0u;
+    size_t states   = 0u;
+    double write_ms = 0.0;
+};
+
+// The periodic snapshots of the greedy search
+struct CheckpointOptions {
+    std::string path;                       // empty - no snapshots
+    std::chrono::seconds interval{ 600 };
+    std::function<void(const CheckpointStats &)> on_checkpoint;
+};
+
 class Solver {
+public:
+    // is called with every improved solution and the weight it was found with
+    using SolutionCallback = std::function<void(const std::vector<PushInfo> &, double)>;
+
 private:
     Solver(const Solver &) = delete;
     Solver(Solver &&) = delete;
     Solver & operator=(const Solver &) = delete;
     Solver & operator=(Solver &&) = delete;
 
+    std::unique_ptr<ThreadPool> _pool;
+    SolverContext _context;
+    std::vector<Tile> _maze;    // the level as read, for the post-processing
+    size_t _width = 0u, _height = 0u;
     Board _board;
     TranspositionTable _trans_table;
+    std::unique_ptr<BitstateTable> _bitstate;   // replaces the table in the greedy search
     TranspositionGraph _trans_graph;
+    StablePriorityQueue<std::pair<stateid_t, BoxState>> _queue;
+    StablePriorityQueue<stateid_t> _compact_queue;     // the open list of the bitstate search
+    std::vector<PushInfo> _rebuild_path;               // the scratch of rebuild_state()
     BoxState _base_state;
 
+    std::optional<std::vector<PushInfo>> _solution;
+    bool _optimal = false;
+    std::optional<std::uint64_t> _cached_states;   // the solution is loaded from the cache
+    // the solution is found by the external or the beam search, which keep
+    // their states outside of the transposition table
+    std::optional<std::uint64_t> _search_states;
+    const char * _search_name = "";
+    bool _prune_symmetries = false;
+    GreedyPriority _greedy_priority = GreedyPriority::Combined;
+    CheckpointOptions _checkpoint;
+    bool _resumed = false;      // the search continues from the loaded snapshot
+    StopReason _stop_reason = StopReason::None;
+    size_t _expanded = 0u;      // by the last search
+
     size_t calculate_priority(const Board::StateStats & stats) const;
+    bool search_greedy(const SearchLimits & limits, bool prune_symmetries, BitstateTable * bitstate);
+    // the state of the graph, replayed from the initial state
+    BoxState rebuild_state(stateid_t state_id);
     size_t max_priority() const;
+    // reports the progress, returns the reason to stop if a limit is exceeded;
+    // frontier_bytes is the memory of the open list beyond memory_usage()
+    std::optional<StopReason> check_limits(const SearchLimits & limits, size_t expanded, size_t stored,
+                                           size_t frontier, size_t frontier_bytes) const;
 
 public:
-    Solver() = default;
+    Solver() : _trans_table{ _context } { }
+
+    // sets the number of threads used for the preprocessing of the next read level
+    void set_preprocess_threads(size_t count);
+
+    // sets the seed of the Zobrist hash table, the default seed is used otherwise;
+    // the search is reproducible for a fixed seed
+    void set_hash_seed(std::uint64_t seed);
+    std::uint64_t hash_seed() const { return _context.zhash.seed(); }
+
+    // The states of a symmetric level which are symmetric to the stored ones
+    // are pruned by the greedy search (solve()); the search keeps the actual
+    // states, so the solution needs no translation. The order of the search
+    // changes, so it is off by default.
+    void set_symmetry_pruning(bool enabled) { _prune_symmetries = enabled; }
+
+    // no single ranking suits all levels, see the portfolio
+    void set_greedy_priority(GreedyPriority priority) { _greedy_priority = priority; }
+
+    // the greedy search with the closed set in a Bloom filter (see BitstateTable), 0 bytes - off
+    void set_bitstate(size_t bytes, size_t hash_count = 3u);
+    std::optional<BitstateStats> bitstate_stats() const;
+
+    // The greedy search writes a snapshot of its tables and open list every
+    // interval. The snapshot is written to a temporary file which replaces
+    // the previous one, so a crash during the write keeps the last snapshot.
+    void set_checkpoint(const CheckpointOptions & options) { _checkpoint = options; }
+    bool write_checkpoint(const std::string & path, CheckpointStats & stats) const;
+    // Loads the snapshot of the search of the current level, the next solve()
+    // continues exactly where the snapshot was taken; returns false if the
+    // snapshot is damaged or belongs to another level
+    bool resume(const std::string & path);
 
+    // Forgets the previous level and its search, the allocated memory
+    // (the transposition table and graph, the open list) is kept for the next level
+    void reset();
+
+    // loads the next level, the solver may be used for any number of levels
     bool read_level_data(std::istream & stream);
     void print_information() const;
     bool solve();
+    // the search stops without a solution when any of the limits is exceeded,
+    // see stop_reason()
+    bool solve(const SearchLimits & limits);
+    StopReason stop_reason() const { return _stop_reason; }
+    // the estimated memory of the tables and the open list of the greedy search
+    size_t memory_usage() const;
+
+    // The greedy search for the first solution, then weighted A* over the push
+    // lower bound, which publishes every shorter solution and continues with a
+    // lower weight. The states of the previous searches stay in the transposition
+    // table and are reopened when a shorter path to them is found. Stops when the
+    // optimum (by pushes) is proven (StopReason::Solved), or the time budget or
+    // a limit of both searches runs out; returns true if any solution was found.
+    bool solve_anytime(const AnytimeOptions & options = {},
+                       const SolutionCallback & on_solution = {},
+                       const SearchLimits & limits = {});
+
+    // The breadth-first search with the layers on the disk (see ExternalSearch),
+    // the number of states is limited by the disk rather than the memory;
+    // the found solution is optimal by pushes; stop_reason() tells
+    // an unsolvable level (Exhausted) from a failed search (IoError)
+    bool solve_external(const ExternalSearchOptions & options);
+
+    // The beam search (see BeamSearch), the fast first pass of the predictable
+    // cost; returns false if no pass found a solution, the level is proven
+    // unsolvable (StopReason::Exhausted) only if no layer was pruned
+    bool solve_beam(const BeamOptions & options = {});
+
+    // Takes the solution of the level from the cache, it is replayed on the board
+    // before it is accepted; returns false if there is no valid stored solution
+    bool load_solution(const SolutionCache & cache);
+    // stores the found solution with the statistics of its search
+    bool store_solution(SolutionCache & cache, std::chrono::milliseconds search_time) const;
+
+    // shortens the found solution by local searches (see SolutionOptimizer),
+    // returns the number of removed pushes
+    size_t optimize_solution(const OptimizerOptions & options = {});
+
+    const std::optional<std::vector<PushInfo>> & solution() const { return _solution; }
+    // the moves of the player of the found solution in the LURD notation
+    std::optional<std::string> solution_moves() const;
+    bool solution_is_optimal() const { return _optimal; }
+    // the number of states stored by the last search
+    size_t state_count() const {
+        if (_search_states.has_value()) { return static_cast<size_t>(_search_states.value()); }
+        return _bitstate ? _bitstate->size() : _trans_table.size();
+    }
+
     void print_solution_format1(std::ostream & stream);
     void print_solution_format2(std::ostream & stream);
 };
@@ -0,0 +1,283 @@
+// Snapshots of the greedy search.
+//
+// Layout (all integers are in the host byte order):
+//   Header
+//   states[state_count]   - the keys of the transposition table by their ids
+//   parents[state_count]  - the parent id and the push of every state
+//   for every priority: uint64 count, then (uint32 id, state)[count]
+//   uint64 checksum of all previous bytes
+// A state is the player (uint16), the boxes (uint16[box_count]) and the goal
+// bits (uint32); the box bitset is rebuilt on loading.
+
+#include "sokoban_solver.h"
+
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace Sokoban;
+using namespace std;
+
+namespace
+{
+constexpr char MAGIC[8] = { 'S', 'O', 'K', 'S', 'N', 'A', 'P', '\0' };
+constexpr uint32_t VERSION = 1u;
+constexpr size_t BUFFER_SIZE = 1u << 20;
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t box_count;
+    uint64_t level_hash;
+    uint64_t hash_seed;
+    uint32_t prune_symmetries;
+    uint32_t priority_count;
+    uint64_t state_count;
+};
+
+uint64_t fnv1a(uint64_t hash, const char * data, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+constexpr uint64_t FNV_BASIS = 0xcbf29ce484222325ull;
+
+uint64_t level_hash(const vector<Tile> & maze, size_t width) {
+    const uint64_t w = width;
+    uint64_t hash = fnv1a(FNV_BASIS, reinterpret_cast<const char *>(&w), sizeof(w));
+    return fnv1a(hash, reinterpret_cast<const char *>(maze.data()), maze.size() * sizeof(Tile));
+}
+
+// the buffered file with the running checksum of the written bytes, the file
+// is on the disk when finish() succeeds, so it can be renamed over the old snapshot
+class SnapshotWriter {
+    vector<char> _buffer;
+    size_t _used = 0u;
+    int _fd = -1;
+    bool _good = false;
+    uint64_t _checksum = FNV_BASIS;
+    size_t _bytes = 0u;
+
+    void write(const char * data, size_t size) {
+        if (_buffer.size() - _used < size) { flush(); }
+        memcpy(_buffer.data() + _used, data, size);
+        _used += size;
+        _bytes += size;
+    }
+
+    void flush() {
+        const char * data = _buffer.data();
+        for (size_t size = _used; _good && size > 0u; ) {
+            const ssize_t count = ::write(_fd, data, size);
+            if (count <= 0) { _good = false; break; }
+            data += count;
+            size -= static_cast<size_t>(count);
+        }
+        _used = 0u;
+    }
+
+public:
+    explicit SnapshotWriter(const string & path) : _buffer(BUFFER_SIZE) {
+        _fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        _good = _fd >= 0;
+    }
+
+    ~SnapshotWriter() {
+        if (_fd >= 0) { ::close(_fd); }
+    }
+
+    SnapshotWriter(const SnapshotWriter &) = delete;
+    SnapshotWriter & operator=(const SnapshotWriter &) = delete;
+
+    template <typename T>
+    void put(const T & value) {
+        const auto * data = reinterpret_cast<const char *>(&value);
+        _checksum = fnv1a(_checksum, data, sizeof(value));
+        write(data, sizeof(value));
+    }
+
+    void put_state(const BoxState & bs, size_t box_count) {
+        put(static_cast<uint16_t>(bs.player_index));
+        for (size_t i = 0; i < box_count; ++i) { put(static_cast<uint16_t>(bs.box_indexes[i])); }
+        put(static_cast<uint32_t>(bs.goal_bits));
+    }
+
+    bool finish() {
+        const uint64_t checksum = _checksum;
+        write(reinterpret_cast<const char *>(&checksum), sizeof(checksum));
+        flush();
+        // the data is durable before the snapshot replaces the previous one
+        if (_good && fsync(_fd) != 0) { _good = false; }
+        if (_fd >= 0 && ::close(_fd) != 0) { _good = false; }
+        _fd = -1;
+        return _good;
+    }
+
+    size_t bytes() const { return _bytes; }
+};
+
+class SnapshotReader {
+    vector<char> _buffer;
+    ifstream _fs;
+    uint64_t _checksum = FNV_BASIS;
+
+public:
+    explicit SnapshotReader(const string & path) : _buffer(BUFFER_SIZE) {
+        _fs.rdbuf()->pubsetbuf(_buffer.data(), static_cast<streamsize>(_buffer.size()));
+        _fs.open(path, ios_base::in | ios_base::binary);
+    }
+
+    template <typename T>
+    bool get(T & value) {
+        auto * data = reinterpret_cast<char *>(&value);
+        if (!_fs.read(data, sizeof(value))) { return false; }
+        _checksum = fnv1a(_checksum, data, sizeof(value));
+        return true;
+    }
+
+    bool get_state(BoxState & bs, size_t box_count, size_t tile_count) {
+        uint16_t index = 0u;
+        uint32_t goal_bits = 0u;
+        if (!get(index) || index >= tile_count) { return false; }
+        bs.player_index = index;
+        bs.box_bits.reset();
+        for (size_t i = 0; i < box_count; ++i) {
+            if (!get(index) || index >= tile_count) { return false; }
+            bs.box_indexes[i] = index;
+            bs.box_bits[index] = true;
+        }
+        if (!get(goal_bits)) { return false; }
+        bs.goal_bits = goal_bits;
+        return true;
+    }
+
+    // the stored checksum matches and nothing follows it
+    bool finish() {
+        const uint64_t expected = _checksum;
+        uint64_t checksum = 0u;
+        if (!_fs.read(reinterpret_cast<char *>(&checksum), sizeof(checksum))) { return false; }
+        return checksum == expected && _fs.peek() == char_traits<char>::eof();
+    }
+};
+}
+
+bool Solver::write_checkpoint(const string & path, CheckpointStats & stats) const {
+    // the bitstate search keeps no states to save
+    if (_bitstate) { return false; }
+
+    const auto start = chrono::steady_clock::now();
+    const size_t box_count = _board.box_count();
+
+    // the table keeps no order, the states are written by their ids
+    vector<const BoxState *> states(_trans_table.size(), nullptr);
+    _trans_table.for_each([&states](const BoxState & bs) { states[bs.unique_index] = &bs; });
+
+    const string temp_path = path + ".tmp";
+    SnapshotWriter writer(temp_path);
+
+    Header header{};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version          = VERSION;
+    header.box_count        = static_cast<uint32_t>(box_count);
+    header.level_hash       = level_hash(_maze, _width);
+    header.hash_seed        = hash_seed();
+    header.prune_symmetries = _prune_symmetries ? 1u : 0u;
+    header.priority_count   = static_cast<uint32_t>(_queue.priority_count());
+    header.state_count      = states.size();
+    writer.put(header);
+
+    for (const auto * bs: states) { writer.put_state(*bs, box_count); }
+    for (stateid_t id = 0; id < states.size(); ++id) {
+        writer.put(static_cast<uint32_t>(_trans_graph.parent(id)));
+        writer.put(static_cast<uint16_t>(_trans_graph.push(id).from()));
+        writer.put(static_cast<uint16_t>(_trans_graph.push(id).to()));
+    }
+    for (size_t priority = 0; priority < _queue.priority_count(); ++priority) {
+        const auto & elements = _queue.elements(priority);
+        writer.put(static_cast<uint64_t>(elements.size()));
+        for (const auto & [id, bs]: elements) {
+            writer.put(static_cast<uint32_t>(id));
+            writer.put_state(bs, box_count);
+        }
+    }
+
+    if (!writer.finish() || rename(temp_path.c_str(), path.c_str()) != 0) {
+        remove(temp_path.c_str());
+        return false;
+    }
+
+    stats.bytes    = writer.bytes();
+    stats.states   = states.size();
+    stats.write_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+bool Solver::resume(const string & path) {
+    if (_bitstate) { return false; }
+
+    const size_t box_count  = _board.box_count();
+    const size_t tile_count = _maze.size();
+
+    SnapshotReader reader(path);
+    Header header;
+    if (!reader.get(header)) { return false; }
+    if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION ||
+        header.box_count != box_count || header.level_hash != level_hash(_maze, _width) ||
+        header.priority_count != max_priority() + 1 || header.state_count == 0u) {
+        return false;
+    }
+
+    // the tables are filled in the order of the ids, so the ids are the same
+    const uint64_t seed = hash_seed();
+    const bool prune_symmetries = _prune_symmetries;
+    reset();
+    set_hash_seed(header.hash_seed);
+    _prune_symmetries = header.prune_symmetries != 0u;
+    _context.box_count = box_count;
+
+    auto fail = [&] {
+        reset();
+        set_hash_seed(seed);
+        _prune_symmetries = prune_symmetries;
+        return false;
+    };
+
+    BoxState bs;
+    for (uint64_t id = 0; id < header.state_count; ++id) {
+        if (!reader.get_state(bs, box_count, tile_count)) { return fail(); }
+        _trans_table.insert_state(bs);
+    }
+    if (_trans_table.size() != header.state_count) { return fail(); }
+
+    for (stateid_t id = 0; id < header.state_count; ++id) {
+        uint32_t parent = 0u;
+        uint16_t from = 0u, to = 0u;
+        if (!reader.get(parent) || !reader.get(from) || !reader.get(to)) { return fail(); }
+        if (parent >= header.state_count) { return fail(); }
+        if (id > 0u) { _trans_graph.insert_state(parent, id, { from, to }); }
+    }
+
+    _queue.reset(header.priority_count);
+    for (size_t priority = 0; priority < header.priority_count; ++priority) {
+        uint64_t count = 0u;
+        if (!reader.get(count)) { return fail(); }
+        for (uint64_t i = 0; i < count; ++i) {
+            uint32_t id = 0u;
+            if (!reader.get(id) || id >= header.state_count) { return fail(); }
+            if (!reader.get_state(bs, box_count, tile_count)) { return fail(); }
+            bs.unique_index = id;
+            _queue.push(priority, { id, bs });
+        }
+    }
+    if (!reader.finish()) { return fail(); }
+
+    _base_state = _board.current_state();
+    _resumed = true;
+    return true;
+}
@@ -0,0 +1,23 @@
+#ifndef SOKOBAN_SOLVER_CONTEXT_H
+#define SOKOBAN_SOLVER_CONTEXT_H
+
+#include "sokoban_common.h"
+#include "zobrist_hash.h"
+
+namespace Sokoban
+{
+// The parameters of the current level shared by the search structures of one
+// solver. Every solver owns its context, so the solvers running in different
+// threads don't share any mutable data.
+struct SolverContext {
+    using zobrist_t = ZobristHash<MAX_TILE_COUNT, boxhash_t>;
+
+    // the table for the default seed is built at compile time
+    static constexpr zobrist_t DEFAULT_ZHASH{ zobrist_t::DEFAULT_SEED };
+
+    size_t box_count = 0u;
+    zobrist_t zhash = DEFAULT_ZHASH;
+};
+}
+
+#endif
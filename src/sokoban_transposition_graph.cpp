@@ -1,6 +1,7 @@
 #include "sokoban_transposition_graph.h"
 #include "string_join.h"
 
+#include <algorithm>
 #include <iomanip>
 #include <ostream>
 #include <cassert>
@@ -13,12 +14,34 @@ TranspositionGraph::TranspositionGraph() : _graph{} {
     _graph.push_back({0u, {0u, 0u}});
 }
 
+void TranspositionGraph::clear() {
+    _graph.clear();
+    _graph.push_back({0u, {0u, 0u}});
+}
+
 void TranspositionGraph::insert_state(stateid_t base_state_id,
                                       stateid_t new_state_id, PushInfo pi) {
     _graph.push_back({base_state_id, pi});
     assert(new_state_id + 1 == _graph.size());
 }
 
+void TranspositionGraph::update_state(stateid_t base_state_id,
+                                      stateid_t state_id, PushInfo pi) {
+    assert(state_id != 0u && state_id < _graph.size());
+    _graph[state_id] = {base_state_id, pi};
+}
+
+std::vector<PushInfo> TranspositionGraph::get_path(stateid_t state_id) const {
+    std::vector<PushInfo> path;
+
+    for (; state_id != 0u; state_id = _graph[state_id].stateid) {
+        path.push_back(_graph[state_id].pushinfo);
+    }
+
+    reverse(begin(path), end(path));
+    return path;
+}
+
 std::optional<std::vector<PushInfo>> TranspositionGraph::get_path() const {
     std::vector<PushInfo> path;
     path.reserve(1000u);
@@ -27,8 +27,21 @@ private:
 public:
     TranspositionGraph();
 
+    // removes all states except the initial one, the memory is kept
+    void clear();
+
     void insert_state(stateid_t base_state_id, stateid_t new_state_id, PushInfo pt);
+    // replaces the parent of the state, when a shorter path to it is found
+    void update_state(stateid_t base_state_id, stateid_t state_id, PushInfo pt);
+
+    stateid_t parent(stateid_t state_id) const { return _graph[state_id].stateid; }
+    const PushInfo & push(stateid_t state_id) const { return _graph[state_id].pushinfo; }
+    size_t size() const { return _graph.size(); }
+    size_t memory_bytes() const { return _graph.size() * sizeof(GValue); }
+
+    // the path to the last inserted state or to the given state
     std::optional<std::vector<PushInfo>> get_path() const;
+    std::vector<PushInfo> get_path(stateid_t state_id) const;
 
     void print(std::ostream & stream) const;
     friend std::ostream & operator<<(std::ostream & stream, const TranspositionGraph::GValue & gv);
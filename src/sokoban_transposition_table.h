@@ -11,16 +11,28 @@ namespace Sokoban
 {
 
 class TranspositionTable {
-    std::unordered_set<BoxState, std::hash<BoxState>> _box_states;
+    std::unordered_set<BoxState, BoxStateHash> _box_states;
     unsigned count;
 
 public:
-    TranspositionTable() : _box_states{}, count{ 0u } {
+    explicit TranspositionTable(const SolverContext & context)
+        : _box_states{ 0u, BoxStateHash{ &context } }, count{ 0u } {
         _box_states.max_load_factor(10.);
         _box_states.reserve(80833);
     }
 
     size_t size() const { return _box_states.size(); }
+    // the estimate: the nodes with their next pointers and the buckets
+    size_t memory_bytes() const {
+        return _box_states.size() * (sizeof(BoxState) + sizeof(void *))
+             + _box_states.bucket_count() * sizeof(void *);
+    }
+
+    // removes all states, the buckets are kept for the next level
+    void clear() {
+        _box_states.clear();
+        count = 0u;
+    }
 
     std::pair<bool, unsigned> insert_state(BoxState newstate) {
         newstate.unique_index = count;
@@ -30,6 +42,11 @@ public:
         return std::make_pair(inserted, it->unique_index);
     }
 
+    template <typename Fn>
+    void for_each(Fn && fn) const {
+        for (const auto & bs: _box_states) { fn(bs); }
+    }
+
     BoxState find(const stateid_t unique_id) const {
         for (size_t i = 0u; i < _box_states.bucket_count(); ++i) {
             for (auto it = _box_states.cbegin(i); it != _box_states.cend(i); ++it) {
@@ -0,0 +1,248 @@
+// Compressed sparse row variant of SparseGraph.
+// The graph is built from a SparseGraph and its structure can't be extended
+// afterwards, but edges and nodes can be removed. The adjacency lists and the
+// reverse index (list of incoming edges for each node) are stored once and
+// shared between the copies of the graph; every copy only owns a per-node mask
+// of live edges. So the removal of a node is O(degree) for both directed and
+// undirected graphs, and a copy of the graph costs one byte per node.
+
+#ifndef CSR_GRAPH_H
+#define CSR_GRAPH_H
+
+#include "sparse_graph.h"
+#include "graph_traversal.h"
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <type_traits>
+#include <cassert>
+#include <iostream>
+#include <iomanip>
+
+template <typename T, size_t ADJ_MAX, bool Directed>
+class CSRGraphEdgesIterator;
+
+template <typename T, size_t ADJ_MAX, bool Directed>
+class CSRGraph {
+private:
+    friend class CSRGraphEdgesIterator<T, ADJ_MAX, Directed>;
+
+    // the smallest type that holds a bit per edge of a node
+    using mask_t = std::conditional_t<ADJ_MAX <= 8,  std::uint8_t,
+                   std::conditional_t<ADJ_MAX <= 16, std::uint16_t,
+                   std::conditional_t<ADJ_MAX <= 32, std::uint32_t, std::uint64_t>>>;
+    static_assert(ADJ_MAX < 64);
+
+    static constexpr mask_t bit(size_t slot) { return static_cast<mask_t>(1ull << slot); }
+
+    struct Topology {
+        std::vector<std::uint32_t> offsets;     // adjacency list of node i is
+        std::vector<T>             targets;     // targets[offsets[i]..offsets[i+1])
+        std::vector<std::uint32_t> rev_offsets; // incoming edges of node i are
+        std::vector<T>             rev_sources; // rev_sources[rev_offsets[i]..rev_offsets[i+1])
+        std::vector<mask_t>        rev_bits;    // and their bits in sources' masks
+    };
+
+    std::shared_ptr<const Topology> _topology;
+    std::vector<mask_t> _alive;
+
+    static std::shared_ptr<const Topology> build(const std::vector<std::vector<T>> & adjacency) {
+        auto topology = std::make_shared<Topology>();
+        const size_t count = adjacency.size();
+
+        topology->offsets.reserve(count + 1);
+        topology->offsets.push_back(0u);
+        for (const auto & adj: adjacency) {
+            topology->targets.insert(std::end(topology->targets), std::begin(adj), std::end(adj));
+            topology->offsets.push_back(static_cast<std::uint32_t>(topology->targets.size()));
+        }
+
+        // counting sort of the edges by their destination, keeps sources ascending
+        topology->rev_offsets.assign(count + 1, 0u);
+        for (const auto to: topology->targets) { topology->rev_offsets[to + 1u]++; }
+        for (size_t i = 0; i < count; ++i) {
+            topology->rev_offsets[i + 1] += topology->rev_offsets[i];
+        }
+
+        topology->rev_sources.resize(topology->targets.size());
+        topology->rev_bits.resize(topology->targets.size());
+        std::vector<std::uint32_t> fill{ std::begin(topology->rev_offsets),
+                                         std::prev(std::end(topology->rev_offsets)) };
+        for (size_t from = 0; from < count; ++from) {
+            for (size_t slot = 0; slot < adjacency[from].size(); ++slot) {
+                const auto pos = fill[adjacency[from][slot]]++;
+                topology->rev_sources[pos] = static_cast<T>(from);
+                topology->rev_bits[pos]    = bit(slot);
+            }
+        }
+
+        return topology;
+    }
+
+    void assign(const std::vector<std::vector<T>> & adjacency) {
+        _topology = build(adjacency);
+
+        _alive.resize(adjacency.size());
+        for (size_t i = 0; i < adjacency.size(); ++i) {
+            _alive[i] = static_cast<mask_t>((1ull << adjacency[i].size()) - 1u);
+        }
+    }
+
+    const T * targets(size_t index) const {
+        return _topology->targets.data() + _topology->offsets[index];
+    }
+
+    // Removes the reference to the edge between <from> and <to> nodes from <from>'s
+    // adjacency list
+    void remove_edge_one_way(T from, T to) {
+        const T * adj = targets(from);
+        const size_t degree = _topology->offsets[from + 1u] - _topology->offsets[from];
+        for (size_t slot = 0; slot < degree; ++slot) {
+            if (adj[slot] == to) { _alive[from] &= static_cast<mask_t>(~bit(slot)); }
+        }
+    }
+
+public:
+    using value_type = T;
+    static constexpr size_t adjacency_max = ADJ_MAX;
+    static constexpr bool   directed      = Directed;
+
+    CSRGraph() { assign({}); }
+
+    // Compresses the adjacency lists of <graph>, keeping the order of the edges
+    explicit CSRGraph(const SparseGraph<T, ADJ_MAX, Directed> & graph) {
+        std::vector<std::vector<T>> adjacency(graph.size());
+        for (size_t i = 0; i < graph.size(); ++i) {
+            graph.for_each_edge(i, [&adj=adjacency[i]](T ind){ adj.push_back(ind); });
+        }
+        assign(adjacency);
+    }
+
+    CSRGraph(const CSRGraph &) = default;
+    CSRGraph(CSRGraph &&) = default;
+    CSRGraph & operator=(const CSRGraph &) = default;
+    CSRGraph & operator=(CSRGraph &&) = default;
+
+    // Returns an iterable object containing information about graph nodes
+    auto nodes() const {
+        return SparseGraphNodes<CSRGraph, false>(*this);
+    }
+
+    // Returns an iterable object containing information about graph nodes.
+    // During the iteration the object calculates the distances between nodes
+    // by the shortest path length
+    auto nodes_with_distances() const {
+        return SparseGraphNodes<CSRGraph, true>(*this);
+    }
+
+    // Returns the count of the nodes in graph
+    size_t size() const noexcept { return _alive.size(); }
+
+    // removes all edges adjacent (in both directions) to a certain node
+    void remove_node(T index) {
+        assert(index < _alive.size());
+
+        _alive[index] = 0u;
+
+        const auto & tp = *_topology;
+        for (auto pos = tp.rev_offsets[index]; pos < tp.rev_offsets[index + 1u]; ++pos) {
+            _alive[tp.rev_sources[pos]] &= static_cast<mask_t>(~tp.rev_bits[pos]);
+        }
+    }
+
+    // Remove the edge between two nodes. In the undirected graph,
+    // both edge marks are removed
+    void remove_edge(T from, T to) {
+        assert(from < _alive.size() && to < _alive.size());
+
+        remove_edge_one_way(from, to);
+        if constexpr (!Directed) {
+            remove_edge_one_way(to, from);
+        }
+    }
+
+    // returns signal flags, indicated which of the nodes are available from the start node
+    std::vector<bool> test_passability(const T start, const std::vector<T> & nodes,
+                                       GraphTraversal<T> & traversal) const {
+        traversal.bfs(*this, start);
+
+        std::vector<bool> result(nodes.size(), false);
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            if (traversal.visited(nodes[i])) { result[i] = true; }
+        }
+        return result;
+    }
+
+    std::vector<bool> test_passability(const T start, const std::vector<T> & nodes) const {
+        GraphTraversal<T> traversal;
+        return test_passability(start, nodes, traversal);
+    }
+
+    // Removes all outgoing edges of the nodes which aren't reachable from the <indexes>.
+    // !currently implemented only for directed graphs
+    void remove_impassable(const std::vector<T> & indexes, GraphTraversal<T> & traversal) {
+        // implemented only for directed graphs
+        if constexpr (!Directed) return;
+
+        traversal.bfs(*this, indexes);
+
+        for (size_t i = 0; i < _alive.size(); i++) {
+            if (!traversal.visited(i)) { _alive[i] = 0u; }
+        }
+    }
+
+    void remove_impassable(const std::vector<T> & indexes) {
+        GraphTraversal<T> traversal;
+        remove_impassable(indexes, traversal);
+    }
+
+    // Transposes this graph, only the live edges are kept
+    void transpose() {
+        // if graph is not directed, it is already symmetric
+        if constexpr (!Directed) { return; }
+
+        std::vector<std::vector<T>> adjacency(_alive.size());
+        for (size_t i = 0u; i < _alive.size(); i++) {
+            for_each_edge(i, [&](T ind){ adjacency[ind].push_back(static_cast<T>(i)); });
+        }
+
+        assign(adjacency);
+    }
+
+    // Calls <fn> for every node adjacent to <index> node
+    template <typename Fn>
+    void for_each_edge(size_t index, Fn && fn) const {
+        const T * adj = targets(index);
+        for (unsigned long long mask = _alive[index]; mask != 0u; mask &= mask - 1u) {
+            fn(adj[__builtin_ctzll(mask)]);
+        }
+    }
+
+    // Returns the iterator through nodes adjacent to <index> node
+    auto edges_begin(size_t index) const {
+        return CSRGraphEdgesIterator<T, ADJ_MAX, Directed>(*this, index);
+    }
+
+    auto edges_end() const {
+        return CSRGraphEdgesIterator<T, ADJ_MAX, Directed>();
+    }
+
+    // Prints the structure of this graph
+    void print() const {
+        using namespace std;
+        for (size_t i = 0; i < _alive.size(); i++) {
+            if (edges_begin(i) == edges_end()) { continue; }
+
+            cout << setw(3) << i << ": ";
+            for (auto it = edges_begin(i); it != edges_end(); ++it) {
+                cout << setw(4) << *it;
+            }
+            cout << '\n';
+        }
+    }
+};
+
+#include "csr_graph_edges_iterator.h"
+
+#endif
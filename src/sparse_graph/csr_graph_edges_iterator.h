@@ -0,0 +1,50 @@
+#ifndef CSR_GRAPH_EDGES_ITERATOR_H
+#define CSR_GRAPH_EDGES_ITERATOR_H
+
+#include <iterator>
+
+template <typename T, size_t ADJ_MAX, bool Directed>
+class CSRGraph;
+
+template <typename T, size_t ADJ_MAX, bool Directed>
+class CSRGraphEdgesIterator {
+    const T * _targets;
+    unsigned long long _mask;
+
+public:
+    CSRGraphEdgesIterator(const CSRGraph<T, ADJ_MAX, Directed> & gn, size_t index)
+        : _targets{ gn.targets(index) }, _mask{ gn._alive[index] } { }
+
+    CSRGraphEdgesIterator() : _targets{nullptr}, _mask{0u} { }
+
+    ~CSRGraphEdgesIterator() { }
+
+    T operator *() const {
+        return _targets[__builtin_ctzll(_mask)];
+    }
+
+    CSRGraphEdgesIterator & operator ++() {
+        _mask &= _mask - 1u;
+        return *this;
+    }
+
+    bool operator !=(const CSRGraphEdgesIterator &) const {
+        return _mask != 0u;
+    }
+
+    bool operator ==(const CSRGraphEdgesIterator & other) const {
+        return !(*this != other);
+    }
+};
+
+namespace std
+{
+template <typename T, size_t ADJ_MAX, bool Directed>
+struct iterator_traits<CSRGraphEdgesIterator<T, ADJ_MAX, Directed>> {
+    using iterator_category = std::forward_iterator_tag;
+    using value_type        = T;
+};
+
+}
+
+#endif
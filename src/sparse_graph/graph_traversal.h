@@ -0,0 +1,122 @@
+// Breadth-first traversal with reusable scratch buffers.
+// Works with any graph type providing size() and for_each_edge().
+// Visited marks are stamped with the number of the current traversal, so
+// a new traversal doesn't need to clear anything. Every node is enqueued at
+// most once per traversal, so the queue is a flat array of the graph size
+// with read and write positions; it also keeps the order of visited nodes.
+// Distances are 16-bit and valid only for visited nodes.
+
+#ifndef GRAPH_TRAVERSAL_H
+#define GRAPH_TRAVERSAL_H
+
+#include <vector>
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+#include <cassert>
+
+template <typename T>
+class GraphTraversal {
+public:
+    using distance_t = std::uint16_t;
+    static constexpr distance_t MAXDISTANCE = std::numeric_limits<distance_t>::max();
+
+private:
+    std::vector<std::uint32_t> _stamps;
+    std::vector<distance_t>    _distances;
+    std::vector<T>             _queue;
+    std::uint32_t _epoch = 0u;
+    size_t        _tail  = 0u;
+
+    void restart(size_t count) {
+        if (_stamps.size() < count) {
+            _stamps.resize(count, 0u);
+            _distances.resize(count);
+            _queue.resize(count);
+        }
+
+        // on overflow of the counter the old stamps become ambiguous
+        if (++_epoch == 0u) {
+            std::fill(std::begin(_stamps), std::end(_stamps), 0u);
+            _epoch = 1u;
+        }
+        _tail = 0u;
+    }
+
+    void push(T index, distance_t dist) {
+        _stamps[index]    = _epoch;
+        _distances[index] = dist;
+        _queue[_tail++]   = index;
+    }
+
+    template <typename Graph, typename Fn>
+    void run(const Graph & graph, Fn && fn) {
+        for (size_t head = 0u; head < _tail; ++head) {
+            const T nodei = _queue[head];
+            const distance_t dist = static_cast<distance_t>(_distances[nodei] + 1u);
+            fn(nodei);
+
+            graph.for_each_edge(nodei, [&](const T ind) {
+                if (_stamps[ind] != _epoch) { push(ind, dist); }
+            });
+        }
+    }
+
+public:
+    GraphTraversal() = default;
+    explicit GraphTraversal(size_t count) { reserve(count); }
+
+    void reserve(size_t count) {
+        _stamps.reserve(count);
+        _distances.reserve(count);
+        _queue.reserve(count);
+    }
+
+    // Visits all nodes reachable from <start> in breadth-first order,
+    // calls <fn> for every visited node
+    template <typename Graph, typename Fn>
+    void bfs(const Graph & graph, const T start, Fn && fn) {
+        assert(start < graph.size());
+
+        restart(graph.size());
+        push(start, 0u);
+        run(graph, fn);
+    }
+
+    template <typename Graph>
+    void bfs(const Graph & graph, const T start) {
+        bfs(graph, start, [](T){});
+    }
+
+    // Visits all nodes reachable from any of the <starts>
+    template <typename Graph, typename Fn>
+    void bfs(const Graph & graph, const std::vector<T> & starts, Fn && fn) {
+        restart(graph.size());
+        for (const auto index: starts) {
+            assert(index < graph.size());
+            if (_stamps[index] != _epoch) { push(index, 0u); }
+        }
+        run(graph, fn);
+    }
+
+    template <typename Graph>
+    void bfs(const Graph & graph, const std::vector<T> & starts) {
+        bfs(graph, starts, [](T){});
+    }
+
+    // results of the last traversal
+    bool visited(size_t index) const {
+        return index < _stamps.size() && _stamps[index] == _epoch;
+    }
+
+    distance_t distance(size_t index) const {
+        return visited(index) ? _distances[index] : MAXDISTANCE;
+    }
+
+    // visited nodes in the order of the traversal
+    const T * begin() const { return _queue.data(); }
+    const T * end()   const { return _queue.data() + _tail; }
+    size_t visited_count() const { return _tail; }
+};
+
+#endif
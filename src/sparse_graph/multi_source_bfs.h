@@ -0,0 +1,124 @@
+// Bit-parallel breadth-first search from many sources at once.
+// Every source has its own bit lane in a machine word kept per node, so
+// one pass over the frontier advances all searches by one level. Only the
+// nodes reached at the previous level are expanded, so the total work is
+// about (number of levels) x (frontier edges), not (sources) x (edges).
+// Works with any graph type providing size() and for_each_edge().
+// The object keeps its buffers between searches.
+
+#ifndef MULTI_SOURCE_BFS_H
+#define MULTI_SOURCE_BFS_H
+
+#include <vector>
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+#include <cassert>
+
+template <typename T>
+class MultiSourceBFS {
+public:
+    using lanes_t = std::uint64_t;
+    static constexpr size_t LANE_COUNT = std::numeric_limits<lanes_t>::digits;
+
+private:
+    std::vector<lanes_t> _visited, _frontier, _next;
+    std::vector<T> _active, _next_active;
+
+public:
+    // Expands the sources [first, last) level by level, i-th source uses i-th lane.
+    // Calls <on_reach>(node, lanes, level) for every node and every group of lanes
+    // that reached it at the same level. Nodes for which <blocked>(node) returns
+    // true are neither entered nor expanded, as if they were removed from the graph.
+    template <typename Graph, typename Blocked, typename OnReach>
+    void expand(const Graph & graph, const T * first, const T * last,
+                Blocked && blocked, OnReach && on_reach) {
+        assert(last - first <= static_cast<std::ptrdiff_t>(LANE_COUNT));
+
+        const size_t count = graph.size();
+        _visited.assign(count, 0u);
+        _frontier.resize(count, 0u);
+        _next.resize(count, 0u);
+        _active.clear();
+        _next_active.clear();
+
+        for (auto it = first; it != last; ++it) {
+            const lanes_t bit = lanes_t{ 1u } << (it - first);
+            if (blocked(*it)) { continue; }
+            if (_frontier[*it] == 0u) { _active.push_back(*it); }
+
+            _frontier[*it] |= bit;
+            _visited[*it]  |= bit;
+        }
+        for (const auto ind: _active) { on_reach(ind, _frontier[ind], 0u); }
+
+        // the frontier words of the expanded nodes are reset during the expansion,
+        // so both buffers are zero again when the search ends
+        for (size_t level = 1u; !_active.empty(); ++level) {
+            for (const auto from: _active) {
+                const lanes_t bits = _frontier[from];
+                _frontier[from] = 0u;
+
+                graph.for_each_edge(from, [&](const T to) {
+                    const lanes_t fresh = bits & ~_visited[to];
+                    if (fresh == 0u || blocked(to)) { return; }
+
+                    if (_next[to] == 0u) { _next_active.push_back(to); }
+                    _next[to]    |= fresh;
+                    _visited[to] |= fresh;
+                });
+            }
+
+            for (const auto ind: _next_active) { on_reach(ind, _next[ind], level); }
+
+            _active.swap(_next_active);
+            _next_active.clear();
+            _frontier.swap(_next);
+        }
+    }
+
+    // Calculates which of (at most LANE_COUNT) sources reach every node.
+    // The result is valid until the next search.
+    template <typename Graph, typename Blocked>
+    const std::vector<lanes_t> & reachability(const Graph & graph, const std::vector<T> & sources,
+                                              Blocked && blocked) {
+        expand(graph, sources.data(), sources.data() + sources.size(),
+               blocked, [](T, lanes_t, size_t){});
+        return _visited;
+    }
+
+    // lanes which reached the node during the last search
+    lanes_t reached(size_t index) const { return _visited[index]; }
+};
+
+// Calculates the distances from every source to every node. The result is a flat
+// table, the distance from sources[i] to node j is stored at [i * graph.size() + j].
+// Unreachable nodes get the maximum value of Distance.
+template <typename Graph, typename Distance = std::uint16_t>
+std::vector<Distance> multi_source_distances(const Graph & graph,
+                            const std::vector<typename Graph::value_type> & sources) {
+    using T = typename Graph::value_type;
+    using lanes_t = typename MultiSourceBFS<T>::lanes_t;
+    constexpr size_t LANE_COUNT = MultiSourceBFS<T>::LANE_COUNT;
+
+    const size_t count = graph.size();
+    std::vector<Distance> table(sources.size() * count, std::numeric_limits<Distance>::max());
+    MultiSourceBFS<T> bfs;
+
+    for (size_t base = 0u; base < sources.size(); base += LANE_COUNT) {
+        const size_t lane_count = std::min(LANE_COUNT, sources.size() - base);
+
+        bfs.expand(graph, sources.data() + base, sources.data() + base + lane_count,
+               [](T){ return false; },
+               [&](const T node, lanes_t bits, size_t level) {
+                   for (; bits != 0u; bits &= bits - 1u) {
+                       const size_t lane = base + static_cast<size_t>(__builtin_ctzll(bits));
+                       table[lane * count + node] = static_cast<Distance>(level);
+                   }
+               });
+    }
+
+    return table;
+}
+
+#endif
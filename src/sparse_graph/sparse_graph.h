@@ -15,10 +15,10 @@
 #include <iostream>
 #include <iomanip>
 
-template <typename T, size_t ADJ_MAX, bool Directed, bool CalcDistances>
+template <typename Graph, bool CalcDistances>
 class SparseGraphNodes;
 
-template <typename T, size_t ADJ_MAX, bool Directed, bool CalcDistances>
+template <typename Graph, bool CalcDistances>
 class SparseGraphNodesIterator;
 
 template <typename T, size_t ADJ_MAX, bool Directed>
@@ -27,8 +27,6 @@ class SparseGraphEdgesIterator;
 template <typename T, size_t ADJ_MAX, bool Directed>
 class SparseGraph {
 private:
-    friend class SparseGraphNodes<T, ADJ_MAX, Directed, true>;
-    friend class SparseGraphNodes<T, ADJ_MAX, Directed, false>;
     friend class SparseGraphEdgesIterator<T, ADJ_MAX, Directed>;
 
     std::vector<std::array<T, ADJ_MAX>> _edges;
@@ -63,6 +61,10 @@ private:
 
 
 public:
+    using value_type = T;
+    static constexpr size_t adjacency_max = ADJ_MAX;
+    static constexpr bool   directed      = Directed;
+
     static constexpr T EMPTY = std::numeric_limits<T>::max();
     static constexpr std::array<T, ADJ_MAX> BLANK = blank_array();
 
@@ -77,14 +79,14 @@ public:
 
     // Returns an iterable object containing information about graph nodes
     auto nodes() const {
-        return SparseGraphNodes<T, ADJ_MAX, Directed, false>(*this);
+        return SparseGraphNodes<SparseGraph, false>(*this);
     }
 
     // Returns an iterable object containing information about graph nodes.
     // During the iteration the object calculates the distances between nodes
     // by the shortest path length
     auto nodes_with_distances() const {
-        return SparseGraphNodes<T, ADJ_MAX, Directed, true>(*this);
+        return SparseGraphNodes<SparseGraph, true>(*this);
     }
 
     // Returns the count of the nodes in graph
@@ -182,6 +184,14 @@ public:
         std::swap(*this, newgraph);
     }
 
+    // Calls <fn> for every node adjacent to <index> node
+    template <typename Fn>
+    void for_each_edge(size_t index, Fn && fn) const {
+        for (const auto ind: _edges[index]) {
+            if (ind != EMPTY) { fn(ind); }
+        }
+    }
+
     // Returns the iterator through nodes adjacent to <index> node
     auto edges_begin(size_t index) const {
         return SparseGraphEdgesIterator<T, ADJ_MAX, Directed>(*this, index);
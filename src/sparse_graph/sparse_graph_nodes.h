@@ -9,21 +9,21 @@
 #include <cassert>
 #include <algorithm>
 
-template <typename T, size_t ADJ_MAX, bool Directed>
-class SparseGraph;
-
-template <typename T, size_t ADJ_MAX, bool Directed, bool CalcDistances>
+template <typename Graph, bool CalcDistances>
 class SparseGraphNodesIterator;
 
-template <typename T, size_t ADJ_MAX, bool Directed, bool CalcDistances>
+// Breadth-first traversal over any graph type providing size() and for_each_edge()
+template <typename Graph, bool CalcDistances>
 class SparseGraphNodes {
-    friend class SparseGraph<T, ADJ_MAX, Directed>;
-    friend class SparseGraphNodesIterator<T, ADJ_MAX, Directed, CalcDistances>;
+    friend Graph;
+    friend class SparseGraphNodesIterator<Graph, CalcDistances>;
+
+    using T = typename Graph::value_type;
 
     using queue_t = std::queue<std::conditional_t<CalcDistances == true, std::pair<size_t, T>, T>>;
     using distances_t = std::conditional_t<CalcDistances == true, std::vector<size_t>, size_t>;
 
-    const SparseGraph<T, ADJ_MAX, Directed> & _graph;
+    const Graph & _graph;
     queue_t     _queue;
     distances_t _distances;
     std::vector<bool> _visited;
@@ -42,9 +42,8 @@ class SparseGraphNodes {
         }
         _queue.pop();
 
-        for (const auto ind: _graph._edges[nodei]) {
-            if (   ind == SparseGraph<T, ADJ_MAX, Directed>::EMPTY
-                || _visited[ind]) { continue; }
+        _graph.for_each_edge(nodei, [&](const T ind) {
+            if (_visited[ind]) { return; }
 
             if constexpr (CalcDistances) {
                 _queue.push(std::make_pair(dist + 1u, ind));
@@ -52,14 +51,14 @@ class SparseGraphNodes {
                 _queue.push(ind);
             }
             _visited[ind] = true;
-        }
+        });
     }
 
-    explicit SparseGraphNodes(const SparseGraph<T, ADJ_MAX, Directed> & g)
+    explicit SparseGraphNodes(const Graph & g)
         : _graph{g}, _queue{}, _distances{},
-          _visited(_graph._edges.size(), false), _traversed{false} {
+          _visited(_graph.size(), false), _traversed{false} {
             if constexpr (CalcDistances) {
-                _distances.resize(_graph._edges.size(), MAXDISTANCE);
+                _distances.resize(_graph.size(), MAXDISTANCE);
             }
     }
 
@@ -94,7 +93,7 @@ public:
             _visited[index] = true;
         }
 
-        return SparseGraphNodesIterator<T, ADJ_MAX, Directed, CalcDistances>(*this);
+        return SparseGraphNodesIterator<Graph, CalcDistances>(*this);
     }
 
     bool visited(size_t index) const {
@@ -113,10 +112,10 @@ public:
         }
         _visited[index] = true;
 
-        return SparseGraphNodesIterator<T, ADJ_MAX, Directed, CalcDistances>(*this);
+        return SparseGraphNodesIterator<Graph, CalcDistances>(*this);
     }
 
-    SparseGraphNodesIterator<T, ADJ_MAX, Directed, CalcDistances> end() const {
+    SparseGraphNodesIterator<Graph, CalcDistances> end() const {
         return {};
     }
 
@@ -3,18 +3,17 @@
 
 #include <iterator>
 
-template <typename T, size_t ADJ_MAX, bool Directed>
-class SparseGraph;
-
-template <typename T, size_t ADJ_MAX, bool Directed, bool CalcDistances>
+template <typename Graph, bool CalcDistances>
 class SparseGraphNodes;
 
-template <typename T, size_t ADJ_MAX, bool Directed, bool CalcDistances>
+template <typename Graph, bool CalcDistances>
 class SparseGraphNodesIterator {
-    SparseGraphNodes<T, ADJ_MAX, Directed, CalcDistances> * _graph_nodes;
+    using T = typename Graph::value_type;
+
+    SparseGraphNodes<Graph, CalcDistances> * _graph_nodes;
 
 public:
-    SparseGraphNodesIterator(SparseGraphNodes<T, ADJ_MAX, Directed, CalcDistances> & gn)
+    SparseGraphNodesIterator(SparseGraphNodes<Graph, CalcDistances> & gn)
         : _graph_nodes{ &gn } { }
 
     SparseGraphNodesIterator() : _graph_nodes{nullptr} { }
@@ -45,10 +44,10 @@ public:
 
 namespace std
 {
-template <typename T, size_t ADJ_MAX, bool Directed, bool CalcDistances>
-struct iterator_traits<SparseGraphNodesIterator<T, ADJ_MAX, Directed, CalcDistances>> {
+template <typename Graph, bool CalcDistances>
+struct iterator_traits<SparseGraphNodesIterator<Graph, CalcDistances>> {
     using iterator_category = std::input_iterator_tag;
-    using value_type        = T;
+    using value_type        = typename Graph::value_type;
 };
 
 }
@@ -0,0 +1,144 @@
+#define BOOST_TEST_MODULE DEADLOCK_DATABASE_TESTS
+
+#include <boost/test/unit_test.hpp>
+#include "deadlocks.h"
+#include "deadlock_database.h"
+#include <fstream>
+#include <cstdio>
+#include <random>
+#include <array>
+#include <optional>
+#include <algorithm>
+
+using namespace Sokoban;
+using namespace std;
+
+const char * dbpath = "test_deadlocks.db";
+
+void write_file(const string & path, const vector<unsigned char> & data) {
+    ofstream fs(path, ios_base::out | ios_base::binary | ios_base::trunc);
+    fs.write(reinterpret_cast<const char *>(data.data()), static_cast<streamsize>(data.size()));
+}
+
+bool equal_points(const vector<Point> & points, const PointSpan & span) {
+    return equal(begin(points), end(points), begin(span), end(span),
+                 [](const Point & l, const PackedPoint & r){ return l.x == r.x && l.y == r.y; });
+}
+
+BOOST_AUTO_TEST_CASE(RoundTrip)
+{
+    write_file(dbpath, DeadlockDatabase::serialize(generated_deadlocks));
+    auto db = DeadlockDatabase::open(dbpath);
+    BOOST_REQUIRE(db);
+
+    size_t pi = 0;
+    for (const auto & dlset: generated_deadlocks) {
+        for (const auto & dlinfo: dlset) {
+            BOOST_REQUIRE(pi < db->size());
+            const auto view = db->pattern(pi++);
+
+            BOOST_CHECK(equal_points(dlinfo.walls,  view.walls()));
+            BOOST_CHECK(equal_points(dlinfo.spaces, view.spaces()));
+            BOOST_CHECK(equal_points(dlinfo.boxes,  view.boxes()));
+            BOOST_CHECK_EQUAL(dlinfo.independent_of_goals, view.independent_of_goals());
+
+            BOOST_REQUIRE_EQUAL(dlinfo.goalsets.size(), view.goalset_count());
+            for (size_t gi = 0; gi < dlinfo.goalsets.size(); ++gi) {
+                BOOST_CHECK(equal_points(dlinfo.goalsets[gi], view.goalset(gi)));
+            }
+        }
+    }
+    BOOST_CHECK_EQUAL(pi, db->size());
+    BOOST_CHECK_EQUAL(db->index().size(), db->size());
+
+    remove(dbpath);
+}
+
+BOOST_AUTO_TEST_CASE(InvalidFiles)
+{
+    BOOST_CHECK(!DeadlockDatabase::open("no_such_file.db"));
+
+    auto data = DeadlockDatabase::serialize(generated_deadlocks);
+
+    // truncated
+    write_file(dbpath, { begin(data), prev(end(data)) });
+    BOOST_CHECK(!DeadlockDatabase::open(dbpath));
+
+    // wrong magic
+    auto wrong = data;
+    wrong[0] = 'X';
+    write_file(dbpath, wrong);
+    BOOST_CHECK(!DeadlockDatabase::open(dbpath));
+
+    // a range of the first pattern is out of bounds
+    wrong = data;
+    auto * pattern = reinterpret_cast<PackedPattern *>(wrong.data() + sizeof(DeadlockDatabase::Header));
+    pattern->walls.offset = 0xFFFFFFFFu;
+    write_file(dbpath, wrong);
+    BOOST_CHECK(!DeadlockDatabase::open(dbpath));
+
+    remove(dbpath);
+}
+
+BOOST_AUTO_TEST_CASE(IndexMatchesLinearScan)
+{
+    auto db = DeadlockDatabase::pack(generated_deadlocks);
+    BOOST_REQUIRE(db);
+    const auto & index = db->index();
+    const auto & cells = index.cells();
+    BOOST_REQUIRE(cells.size() <= 64u);
+
+    // random boards, the tiles near the border have cells of the neighbourhood outside of the board
+    constexpr int WIDTH = 9, HEIGHT = 7;
+    mt19937 rng(20240601u);
+    bernoulli_distribution is_wall(0.35);
+
+    const array<pair<int, int>, 4> reflections = {{ {1, 1}, {1, -1}, {-1, 1}, {-1, -1} }};
+    vector<size_t> candidates, expected;
+    size_t matched = 0u;
+
+    for (int board = 0; board < 50; ++board) {
+        vector<bool> walls(WIDTH * HEIGHT);
+        for (size_t i = 0; i < walls.size(); ++i) { walls[i] = is_wall(rng); }
+
+        // the reflected cell relative to (x, y), nullopt - outside of the board
+        auto tile = [&](int x, int y, int dx, int dy, const pair<int, int> & refl) -> optional<int> {
+            const int cx = x + refl.first * dx, cy = y + refl.second * dy;
+            if (cx < 0 || cy < 0 || cx >= WIDTH || cy >= HEIGHT) { return nullopt; }
+            return cy * WIDTH + cx;
+        };
+
+        for (int y = 0; y < HEIGHT; ++y) {
+            for (int x = 0; x < WIDTH; ++x) {
+                for (const auto & refl: reflections) {
+                    DeadlockIndex::signature_t wall_bits = 0u, inside = 0u;
+                    for (size_t ci = 0; ci < cells.size(); ++ci) {
+                        const auto ti = tile(x, y, cells[ci].x, cells[ci].y, refl);
+                        if (!ti) { continue; }
+
+                        const auto bit = DeadlockIndex::signature_t{ 1u } << ci;
+                        inside |= bit;
+                        if (walls[*ti]) { wall_bits |= bit; }
+                    }
+                    index.candidates(wall_bits, inside, candidates);
+
+                    expected.clear();
+                    for (size_t pi = 0; pi < db->size(); ++pi) {
+                        const auto view = db->pattern(pi);
+                        auto test = [&](const PointSpan & points, bool wall) {
+                            return all_of(begin(points), end(points), [&](const PackedPoint & p) {
+                                const auto ti = tile(x, y, p.x, p.y, refl);
+                                return ti && walls[*ti] == wall;
+                            });
+                        };
+                        if (test(view.walls(), true) && test(view.spaces(), false)) { expected.push_back(pi); }
+                    }
+
+                    BOOST_REQUIRE(candidates == expected);
+                    matched += expected.size();
+                }
+            }
+        }
+    }
+    BOOST_CHECK(matched > 0u);
+}
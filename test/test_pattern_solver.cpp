@@ -0,0 +1,111 @@
+#define BOOST_TEST_MODULE PATTERN_SOLVER_TESTS
+
+#include <boost/test/unit_test.hpp>
+#include "pattern_solver.h"
+#include "sokoban_solver.h"
+#include <random>
+#include <sstream>
+#include <algorithm>
+
+using namespace Sokoban;
+using namespace std;
+
+// the frame of the boards of the deadlock generator: the pattern cells in the
+// middle, the cells of the extra goals ('1') and the extra boxes ('2')
+const char * frame = 1 + R"(
+########
+#1111  #
+# 22   #
+#  ??  #
+#  ??  #
+# 22   #
+#     @#
+########
+)";
+
+// a random pattern board with as many goals as boxes
+string generate_board(mt19937 & random) {
+    string level = frame;
+    vector<size_t> pattern, goal_cells, box_cells;
+    for (size_t i = 0; i < level.size(); ++i) {
+        if (level[i] == '?') { pattern.push_back(i); }
+        if (level[i] == '1') { goal_cells.push_back(i); level[i] = ' '; }
+        if (level[i] == '2') { box_cells.push_back(i);  level[i] = ' '; }
+    }
+
+    vector<size_t> free_cells;
+    for (const auto i: pattern) {
+        if (random() % 3u == 0u) { level[i] = '#'; }
+        else                     { level[i] = ' '; free_cells.push_back(i); }
+    }
+
+    // the boxes on the pattern and the extra cells, the goals on the pattern and the extra cells
+    box_cells.insert(end(box_cells), begin(free_cells), end(free_cells));
+    goal_cells.insert(end(goal_cells), begin(free_cells), end(free_cells));
+    shuffle(begin(box_cells), end(box_cells), random);
+    shuffle(begin(goal_cells), end(goal_cells), random);
+
+    const size_t count = 1u + random() % 3u;
+    for (size_t k = 0; k < count; ++k) { level[box_cells[k]] = '$'; }
+    for (size_t k = 0; k < count; ++k) {
+        level[goal_cells[k]] = level[goal_cells[k]] == '$' ? '*' : '.';
+    }
+    return level;
+}
+
+bool solve_exact(const string & level) {
+    Solver solver;
+    istringstream iss(level);
+    BOOST_REQUIRE(solver.read_level_data(iss));
+    return solver.solve();
+}
+
+BOOST_AUTO_TEST_CASE(GeneratedBoards)
+{
+    mt19937 random(12345u);
+    PatternSolver pattern_solver;
+    size_t solvable = 0u, unsolvable = 0u;
+
+    for (size_t n = 0; n < 300u; ++n) {
+        const string level = generate_board(random);
+        BOOST_REQUIRE(pattern_solver.parse(level));
+
+        const auto solved = pattern_solver.solve();
+        BOOST_REQUIRE_MESSAGE(solved.has_value(), level);
+        BOOST_CHECK_MESSAGE(solved.value() == solve_exact(level), level);
+        ++(solved.value() ? solvable : unsolvable);
+    }
+    BOOST_CHECK_GT(solvable, 0u);
+    BOOST_CHECK_GT(unsolvable, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(LargeBoards)
+{
+    PatternSolver pattern_solver;
+
+    // the boards beyond 8x8 are left to the solver
+    BOOST_CHECK(!pattern_solver.parse(string(9, ' ') + "\n"));
+
+    // the goal in the corridor can't be reached by a box: the search visits all
+    // positions of the six boxes in the open room, the visited set overflows
+    // and the generator falls back to the solver
+    const char * level = 1 + R"(
+########
+#... ..#
+# $$$  #
+# $ $$ #
+#      #
+###### #
+#.    @#
+########
+)";
+    BOOST_REQUIRE(pattern_solver.parse(level));
+    BOOST_CHECK(!pattern_solver.solve().has_value());
+    BOOST_CHECK(!solve_exact(level));
+
+    // the table is reused by the next search
+    BOOST_REQUIRE(pattern_solver.parse("#####\n#@$.#\n#####\n"));
+    const auto solved = pattern_solver.solve();
+    BOOST_REQUIRE(solved.has_value());
+    BOOST_CHECK(solved.value());
+}
@@ -0,0 +1,216 @@
+#define BOOST_TEST_MODULE SOLUTION_CACHE_TESTS
+
+#include <boost/test/unit_test.hpp>
+#include "test_solver_common.h"
+#include "sokoban_solution_cache.h"
+#include "sokoban_solver.h"
+#include <fstream>
+#include <sstream>
+#include <iterator>
+#include <cstdio>
+#include <filesystem>
+#include <unistd.h>
+
+using namespace Sokoban;
+using namespace std;
+
+// the files of the cache are kept out of the working directory
+const string cache_path = (filesystem::temp_directory_path() /
+                           ("test_solutions_" + to_string(getpid()))).string();
+
+vector<string> read_lines(const string & level) {
+    vector<string> lines;
+    istringstream iss(level);
+    for (string line; getline(iss, line) && !line.empty(); ) { lines.push_back(line); }
+    return lines;
+}
+
+// the level turned by 90 degrees clockwise
+string rotate(const string & level) {
+    const auto lines = read_lines(level);
+    string result;
+    for (size_t x = 0; x < lines[0].size(); ++x) {
+        for (size_t y = lines.size(); y-- > 0; ) { result.push_back(lines[y][x]); }
+        result.push_back('\n');
+    }
+    return result;
+}
+
+string mirror(const string & level) {
+    string result;
+    for (auto line: read_lines(level)) { result += string(line.rbegin(), line.rend()) + '\n'; }
+    return result;
+}
+
+void remove_cache() {
+    remove((cache_path + ".log").c_str());
+    remove((cache_path + ".idx").c_str());
+}
+
+BOOST_AUTO_TEST_CASE(CanonicalSymmetries)
+{
+    const string level = read_level("example03.sok");
+    const auto [maze, width, height] = parse_level(level);
+    const CanonicalLevel canonical(maze, width, height);
+
+    string variant = level;
+    for (size_t i = 0; i < 4u; ++i) {
+        for (const auto & v: { variant, mirror(variant) }) {
+            const auto [vmaze, vwidth, vheight] = parse_level(v);
+            const CanonicalLevel vcanonical(vmaze, vwidth, vheight);
+            BOOST_CHECK_EQUAL(vcanonical.key(), canonical.key());
+            BOOST_CHECK(vcanonical.bytes() == canonical.bytes());
+
+            for (index_t j = 0; j < vmaze.size(); ++j) {
+                if (tile_is_wall(vmaze[j])) { continue; }
+                BOOST_CHECK_EQUAL(vcanonical.from_canonical(vcanonical.to_canonical(j)), j);
+                BOOST_CHECK(vmaze[j] == maze[canonical.from_canonical(vcanonical.to_canonical(j))]);
+            }
+        }
+        variant = rotate(variant);
+    }
+
+    // the unreachable floor outside the walls doesn't change the level
+    const auto lines = read_lines(level);
+    string padded;
+    for (const auto & line: lines) { padded += "  " + line + "  \n"; }
+    const auto [pmaze, pwidth, pheight] = parse_level(padded);
+    BOOST_CHECK(CanonicalLevel(pmaze, pwidth, pheight).bytes() == canonical.bytes());
+}
+
+BOOST_AUTO_TEST_CASE(StoreAndLookup)
+{
+    remove_cache();
+    const string level = read_level("jr03.sok");
+
+    {
+        auto cache = SolutionCache::open(cache_path);
+        BOOST_REQUIRE(cache);
+        BOOST_CHECK(!SolutionCache::open(cache_path));  // locked by the first one
+
+        Solver solver;
+        istringstream iss(level);
+        BOOST_REQUIRE(solver.read_level_data(iss));
+        BOOST_CHECK(!solver.load_solution(*cache));
+        BOOST_REQUIRE(solver.solve());
+        BOOST_REQUIRE(solver.store_solution(*cache, chrono::milliseconds{ 5 }));
+        BOOST_CHECK_EQUAL(cache->size(), 1u);
+    }
+
+    // the solution is translated to every symmetric variant of the level
+    auto cache = SolutionCache::open(cache_path);
+    BOOST_REQUIRE(cache);
+    for (const auto & variant: { level, rotate(level), mirror(rotate(rotate(level))) }) {
+        Solver solver;
+        istringstream iss(variant);
+        BOOST_REQUIRE(solver.read_level_data(iss));
+        BOOST_CHECK(solver.load_solution(*cache));
+        BOOST_CHECK_EQUAL(solver.solution()->size(), 16u);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(Recovery)
+{
+    remove_cache();
+
+    auto read_file = [](const string & path) {
+        ifstream fs(path, ios_base::in | ios_base::binary);
+        return string(istreambuf_iterator<char>{fs}, {});
+    };
+    const string index_path = cache_path + ".idx";
+
+    vector<pair<string, size_t>> levels;
+    string old_index;
+    for (const auto & names: { vector<string>{ "jr01.sok", "jr03.sok", "jr06.sok" },
+                               vector<string>{ "example03.sok", "bipartite01.sok" } }) {
+        old_index = read_file(index_path);
+
+        auto cache = SolutionCache::open(cache_path);
+        BOOST_REQUIRE(cache);
+        for (const auto & name: names) {
+            Solver solver;
+            istringstream iss(read_level(name));
+            BOOST_REQUIRE(solver.read_level_data(iss));
+            BOOST_REQUIRE(solver.solve());
+            BOOST_REQUIRE(solver.store_solution(*cache, chrono::milliseconds{ 1 }));
+            levels.emplace_back(read_level(name), solver.solution()->size());
+        }
+    }
+
+    auto check = [&levels](size_t expected) {
+        auto cache = SolutionCache::open(cache_path);
+        BOOST_REQUIRE(cache);
+        size_t found = 0u;
+        for (const auto & [level, length]: levels) {
+            const auto [maze, width, height] = parse_level(level);
+            const auto entry = cache->lookup(maze, width, height);
+            if (entry.has_value()) {
+                BOOST_CHECK_EQUAL(entry->pushes.size(), length);
+                ++found;
+            }
+        }
+        BOOST_CHECK_EQUAL(found, expected);
+    };
+
+    // a torn record at the end of the log is dropped
+    { ofstream fs(cache_path + ".log", ios_base::app | ios_base::binary); fs << "DCERtorn"; }
+    check(levels.size());
+
+    // a damaged index is rebuilt from the log
+    { ofstream fs(index_path, ios_base::trunc | ios_base::binary); fs << "garbage"; }
+    check(levels.size());
+
+    // the index without the last records catches up with the log
+    { ofstream fs(index_path, ios_base::trunc | ios_base::binary); fs << old_index; }
+    check(levels.size());
+
+    // a damaged record in the middle of the log is skipped, the records after it are kept
+    const string log_path = cache_path + ".log";
+    const auto log_size = read_file(log_path).size();
+    {
+        fstream fs(log_path, ios_base::in | ios_base::out | ios_base::binary);
+        fs.seekp(40);   // the payload of the first record
+        fs.put('\xFF');
+    }
+    { ofstream fs(index_path, ios_base::trunc | ios_base::binary); fs << "garbage"; }
+    check(levels.size() - 1u);
+    BOOST_CHECK_EQUAL(read_file(log_path).size(), log_size);
+
+    remove_cache();
+}
+
+BOOST_AUTO_TEST_CASE(RejectedEntry)
+{
+    const string level = read_level("jr03.sok");
+    const auto [maze, width, height] = parse_level(level);
+
+    Solver reference;
+    istringstream reference_iss(level);
+    BOOST_REQUIRE(reference.read_level_data(reference_iss));
+    BOOST_REQUIRE(reference.solve());
+    const auto & solution = reference.solution().value();
+
+    // the first push is replayed before the entry is rejected
+    for (const auto & pushes: { vector<PushInfo>{ solution[0], solution[0] },
+                                vector<PushInfo>{ solution[0] } }) {
+        remove_cache();
+        auto cache = SolutionCache::open(cache_path);
+        BOOST_REQUIRE(cache);
+        BOOST_REQUIRE(cache->store(maze, width, height, { pushes, 1u, 1u }));
+
+        Solver solver;
+        istringstream iss(level);
+        BOOST_REQUIRE(solver.read_level_data(iss));
+        BOOST_CHECK(!solver.load_solution(*cache));
+
+        // the search starts from the initial state of the level
+        BOOST_REQUIRE(solver.solve());
+        BOOST_CHECK(solver.solution_moves().has_value());
+        BOOST_REQUIRE_EQUAL(solver.solution()->size(), solution.size());
+        for (size_t i = 0; i < solution.size(); ++i) {
+            BOOST_CHECK_EQUAL(solver.solution().value()[i].from(), solution[i].from());
+            BOOST_CHECK_EQUAL(solver.solution().value()[i].to(), solution[i].to());
+        }
+    }
+    remove_cache();
+}
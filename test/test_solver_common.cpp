@@ -1,15 +1,26 @@
 #include <boost/test/unit_test.hpp>
 #include "sokoban_solver.h"
+#include "sokoban_formatter.h"
 
 #include <string_view>
 #include <vector>
 #include <sstream>
 #include <algorithm>
+#include <fstream>
+#include <iterator>
+
+#include "test_solver_common.h"
 
 using namespace std;
 
-bool test(const string_view & indata, const vector<string_view> & outdata) {
+bool test(const string_view & indata, const vector<string_view> & outdata,
+          size_t preprocess_threads) {
     Sokoban::Solver solver;
+    solver.set_preprocess_threads(preprocess_threads);
+    return test(solver, indata, outdata);
+}
+
+bool test(Sokoban::Solver & solver, const string_view & indata, const vector<string_view> & outdata) {
     istringstream iss(string{indata});
 
     bool is_read = solver.read_level_data(iss);
@@ -31,3 +42,24 @@ bool test(const string_view & indata, const vector<string_view> & outdata) {
 
     return test_result;
 }
+
+string read_level(const string & name) {
+    ifstream fs("./levels/" + name, ios_base::in);
+    return string(istreambuf_iterator<char>{fs}, {});
+}
+
+tuple<vector<Sokoban::Tile>, size_t, size_t> parse_level(const string_view & level) {
+    istringstream iss(string{level});
+    vector<Sokoban::Tile> maze;
+    size_t width = 0u, height = 0u;
+    for (string line; getline(iss, line) && !line.empty(); ++height) {
+        if (height == 0u) { width = line.size(); }
+        BOOST_REQUIRE_EQUAL(line.size(), width);
+        for (const char ch: line) {
+            const auto tile = Sokoban::Formatter::encode(ch);
+            BOOST_REQUIRE(tile.has_value());
+            maze.push_back(tile.value());
+        }
+    }
+    return { maze, width, height };
+}
@@ -1,3 +1,20 @@
-extern bool test(const std::string_view & indata,
+#include "sokoban_common.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <tuple>
+
+namespace Sokoban { class Solver; }
+
+extern bool test(Sokoban::Solver & solver,
+                 const std::string_view & indata,
                  const std::vector<std::string_view> & outdata);
+extern bool test(const std::string_view & indata,
+                 const std::vector<std::string_view> & outdata,
+                 size_t preprocess_threads = 0);
 
+// the text of the level file from ./levels/
+extern std::string read_level(const std::string & name);
+// the tiles of the level (up to the first empty line), its width and height
+extern std::tuple<std::vector<Sokoban::Tile>, size_t, size_t> parse_level(const std::string_view & level);
@@ -2,8 +2,15 @@
 
 #include <boost/test/unit_test.hpp>
 #include "test_solver_common.h"
+#include "deadlocks.h"
+#include "deadlock_database.h"
+#include "sokoban_solver.h"
+#include <thread>
+#include <sstream>
 #include <fstream>
 #include <streambuf>
+#include <algorithm>
+#include <cstdio>
 
 using namespace std;
 
@@ -42,3 +49,276 @@ BOOST_AUTO_TEST_CASE(Level03)
     test(indata, {outdata});
 }
 
+string solve_to_string(const string & indata, size_t preprocess_threads = 0) {
+    Sokoban::Solver solver;
+    solver.set_preprocess_threads(preprocess_threads);
+    istringstream iss(indata);
+    ostringstream oss;
+    if (solver.read_level_data(iss) && solver.solve()) {
+        solver.print_solution_format1(oss);
+    }
+    return oss.str();
+}
+
+BOOST_AUTO_TEST_CASE(Level03ParallelPreprocessing)
+{
+    ifstream fs(string(filepath) + "03.sok", ios_base::in);
+    string indata(istreambuf_iterator<char>{fs}, {});
+
+    // the parallel preprocessing gives the tables of the sequential one
+    const string expected = solve_to_string(indata);
+    BOOST_REQUIRE(!expected.empty());
+    BOOST_CHECK_EQUAL(solve_to_string(indata, 4), expected);
+}
+
+BOOST_AUTO_TEST_CASE(Level03DeadlocksFromFile)
+{
+    ifstream fs(string(filepath) + "03.sok", ios_base::in);
+    string indata(istreambuf_iterator<char>{fs}, {});
+
+    const string expected = solve_to_string(indata);
+    const char * dbpath = "level03_deadlocks.db";
+    BOOST_REQUIRE(Sokoban::DeadlockDatabase::write(dbpath, Sokoban::generated_deadlocks[0]));
+
+    auto db = Sokoban::DeadlockDatabase::open(dbpath);
+    BOOST_REQUIRE(db);
+    BOOST_REQUIRE(db->size() == Sokoban::generated_deadlocks[0].size());
+
+    Sokoban::set_active_deadlocks(db);
+    BOOST_CHECK_EQUAL(solve_to_string(indata), expected);
+    Sokoban::set_active_deadlocks(nullptr);
+
+    remove(dbpath);
+}
+
+BOOST_AUTO_TEST_CASE(ConcurrentSolvers)
+{
+    vector<string> levels;
+    for (const char * name: { "01.sok", "02.sok", "03.sok", "01.sok" }) {
+        ifstream fs(string(filepath) + name, ios_base::in);
+        levels.emplace_back(istreambuf_iterator<char>{fs}, istreambuf_iterator<char>{});
+    }
+
+    vector<string> expected;
+    for (const auto & level: levels) { expected.push_back(solve_to_string(level)); }
+
+    // every solver has its own context, so the results don't depend on other threads
+    vector<string> observed(levels.size());
+    vector<thread> threads;
+    for (size_t i = 0; i < levels.size(); ++i) {
+        threads.emplace_back([&, i]{ observed[i] = solve_to_string(levels[i]); });
+    }
+    for (auto & t: threads) { t.join(); }
+
+    for (size_t i = 0; i < levels.size(); ++i) {
+        BOOST_CHECK(!expected[i].empty());
+        BOOST_CHECK_EQUAL(expected[i], observed[i]);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(Level02AnytimeWithBudget)
+{
+    ifstream fs(string(filepath) + "02.sok", ios_base::in);
+    string indata(istreambuf_iterator<char>{fs}, {});
+
+    Sokoban::Solver solver;
+    istringstream iss(indata);
+    BOOST_REQUIRE(solver.read_level_data(iss));
+
+    // the budget in expansions doesn't depend on the speed of the machine
+    vector<size_t> lengths;
+    Sokoban::AnytimeOptions options;
+    Sokoban::SearchLimits limits;
+    limits.max_expanded = 50000u;
+    const bool solved = solver.solve_anytime(options, [&lengths](const auto & pushes, double) {
+        lengths.push_back(pushes.size());
+    }, limits);
+
+    // the first solution is the one of the greedy search, the next ones are shorter
+    BOOST_REQUIRE(solved);
+    BOOST_REQUIRE(!lengths.empty());
+    BOOST_CHECK_EQUAL(lengths.front(), 139u);
+    for (size_t i = 1; i < lengths.size(); ++i) { BOOST_CHECK_LT(lengths[i], lengths[i - 1]); }
+    BOOST_CHECK_GT(lengths.size(), 1u);
+    BOOST_CHECK_EQUAL(solver.solution()->size(), lengths.back());
+}
+
+BOOST_AUTO_TEST_CASE(Level02OptimizedSolution)
+{
+    ifstream fs(string(filepath) + "02.sok", ios_base::in);
+    string indata(istreambuf_iterator<char>{fs}, {});
+
+    Sokoban::Solver solver;
+    istringstream iss(indata);
+    BOOST_REQUIRE(solver.read_level_data(iss));
+    BOOST_REQUIRE(solver.solve());
+    const size_t greedy_size = solver.solution()->size();
+
+    // the shortened solution is replayed by the optimizer, an invalid one isn't accepted
+    Sokoban::OptimizerOptions options;
+    options.threads = 2;
+    const size_t removed = solver.optimize_solution(options);
+
+    BOOST_CHECK_GT(removed, 0u);
+    BOOST_CHECK_EQUAL(solver.solution()->size() + removed, greedy_size);
+}
+
+BOOST_AUTO_TEST_CASE(Level02ResumedFromCheckpoint)
+{
+    ifstream fs(string(filepath) + "02.sok", ios_base::in);
+    string indata(istreambuf_iterator<char>{fs}, {});
+    const string snapshot = "test_level02.snapshot";
+
+    Sokoban::Solver full;
+    istringstream iss(indata);
+    BOOST_REQUIRE(full.read_level_data(iss));
+    BOOST_REQUIRE(full.solve());
+
+    // the search is interrupted after a snapshot
+    {
+        Sokoban::Solver solver;
+        Sokoban::CheckpointOptions checkpoint;
+        checkpoint.path = snapshot;
+        checkpoint.interval = chrono::seconds{ 0 };
+        size_t checkpoints = 0u;
+        checkpoint.on_checkpoint = [&checkpoints](const Sokoban::CheckpointStats & stats) {
+            BOOST_CHECK_GT(stats.bytes, stats.states);
+            ++checkpoints;
+        };
+        solver.set_checkpoint(checkpoint);
+
+        istringstream iss(indata);
+        BOOST_REQUIRE(solver.read_level_data(iss));
+        Sokoban::SearchLimits limits;
+        limits.max_states = 10000u;
+        BOOST_REQUIRE(!solver.solve(limits));
+        BOOST_REQUIRE_GT(checkpoints, 0u);
+    }
+
+    // the resumed search finds the same solution with the same states
+    Sokoban::Solver solver;
+    istringstream iss2(indata);
+    BOOST_REQUIRE(solver.read_level_data(iss2));
+    BOOST_REQUIRE(solver.resume(snapshot));
+    BOOST_CHECK_GT(solver.state_count(), 1u);
+    BOOST_REQUIRE(solver.solve());
+    const auto & pushes = solver.solution().value();
+    const auto & expected = full.solution().value();
+    BOOST_CHECK(equal(begin(pushes), end(pushes), begin(expected), end(expected),
+                      [](const auto & l, const auto & r) { return l.from() == r.from() && l.to() == r.to(); }));
+    BOOST_CHECK_EQUAL(solver.state_count(), full.state_count());
+
+    // the snapshot of another level is rejected
+    Sokoban::Solver other;
+    ifstream fs1(string(filepath) + "01.sok", ios_base::in);
+    istringstream level01(string(istreambuf_iterator<char>{fs1}, {}));
+    BOOST_REQUIRE(other.read_level_data(level01));
+    BOOST_CHECK(!other.resume(snapshot));
+
+    remove(snapshot.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(Level01BeamWithRestarts)
+{
+    ifstream fs(string(filepath) + "01.sok", ios_base::in);
+    string indata(istreambuf_iterator<char>{fs}, {});
+
+    // the narrow beams fail, the search restarts with the doubled width
+    Sokoban::BeamOptions options;
+    options.width = 200u;
+    options.max_width = 1600u;
+    vector<size_t> widths;
+    options.on_pass = [&widths](size_t width, size_t depth, size_t states) {
+        BOOST_CHECK_LE(states, width * depth + 1u);
+        widths.push_back(width);
+    };
+
+    Sokoban::Solver solver;
+    istringstream iss(indata);
+    BOOST_REQUIRE(solver.read_level_data(iss));
+    BOOST_REQUIRE(solver.solve_beam(options));
+    BOOST_CHECK(solver.solution_moves().has_value());
+    BOOST_CHECK(!solver.solution_is_optimal());
+    BOOST_CHECK((widths == vector<size_t>{ 200u, 400u, 800u }));
+    BOOST_CHECK(solver.stop_reason() == Sokoban::StopReason::Solved);
+
+    // a failed beam isn't a proof of the unsolvability
+    options.max_width = options.width = 50u;
+    istringstream narrow_iss(indata);
+    BOOST_REQUIRE(solver.read_level_data(narrow_iss));
+    BOOST_CHECK(!solver.solve_beam(options));
+    BOOST_CHECK(solver.stop_reason() == Sokoban::StopReason::StateLimit);
+    options.max_depth = 5u;
+    BOOST_CHECK(!solver.solve_beam(options));
+    BOOST_CHECK(solver.stop_reason() == Sokoban::StopReason::DepthLimit);
+}
+
+BOOST_AUTO_TEST_CASE(Level02SearchLimits)
+{
+    ifstream fs(string(filepath) + "02.sok", ios_base::in);
+    const string indata(istreambuf_iterator<char>{fs}, {});
+    using Sokoban::StopReason;
+
+    Sokoban::Solver solver;
+    auto solve = [&](const Sokoban::SearchLimits & limits) {
+        istringstream iss(indata);
+        BOOST_REQUIRE(solver.read_level_data(iss));
+        return solver.solve(limits);
+    };
+
+    // the progress is reported every check period
+    Sokoban::SearchLimits limits;
+    limits.check_period = 500u;
+    size_t reports = 0u;
+    limits.on_progress = [&](const Sokoban::SearchProgress & progress) {
+        ++reports;
+        BOOST_CHECK_EQUAL(progress.expanded, reports * 500u);
+        BOOST_CHECK_GT(progress.frontier, 0u);
+        BOOST_CHECK_GT(progress.stored, progress.frontier);
+        BOOST_CHECK_GT(progress.memory_bytes, progress.stored * sizeof(Sokoban::BoxState));
+    };
+    BOOST_REQUIRE(solve(limits));
+    BOOST_CHECK(solver.stop_reason() == StopReason::Solved);
+    BOOST_CHECK_GT(reports, 0u);
+    limits.on_progress = nullptr;
+
+    Sokoban::SearchLimits expansions = limits;
+    expansions.max_expanded = 1000u;
+    BOOST_CHECK(!solve(expansions));
+    BOOST_CHECK(solver.stop_reason() == StopReason::ExpansionLimit);
+
+    Sokoban::SearchLimits memory = limits;
+    memory.max_memory = 1u << 20;
+    BOOST_CHECK(!solve(memory));
+    BOOST_CHECK(solver.stop_reason() == StopReason::MemoryLimit);
+    BOOST_CHECK_LT(solver.memory_usage(), 2u << 20);
+
+    const atomic<bool> cancelled{ true };
+    Sokoban::SearchLimits cancel = limits;
+    cancel.cancel = &cancelled;
+    BOOST_CHECK(!solve(cancel));
+    BOOST_CHECK(solver.stop_reason() == StopReason::Cancelled);
+    BOOST_CHECK_LT(solver.state_count(), 10000u);
+
+    Sokoban::SearchLimits deadline = limits;
+    deadline.deadline = chrono::steady_clock::now();
+    BOOST_CHECK(!solve(deadline));
+    BOOST_CHECK(solver.stop_reason() == StopReason::Deadline);
+
+    // the limits of the anytime search cover the weighted search, its solution stays
+    istringstream anytime_iss(indata);
+    BOOST_REQUIRE(solver.read_level_data(anytime_iss));
+    Sokoban::SearchLimits anytime = limits;
+    anytime.max_expanded = 30000u;
+    BOOST_REQUIRE(solver.solve_anytime({}, {}, anytime));
+    BOOST_CHECK(solver.stop_reason() == StopReason::ExpansionLimit);
+    BOOST_CHECK(!solver.solution_is_optimal());
+    BOOST_CHECK(solver.solution_moves().has_value());
+
+    anytime.max_expanded = 0u;
+    anytime.cancel = &cancelled;
+    istringstream cancel_iss(indata);
+    BOOST_REQUIRE(solver.read_level_data(cancel_iss));
+    BOOST_CHECK(!solver.solve_anytime({}, {}, anytime));
+    BOOST_CHECK(solver.stop_reason() == StopReason::Cancelled);
+}
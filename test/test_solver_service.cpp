@@ -0,0 +1,192 @@
+#define BOOST_TEST_MODULE SOLVER_SERVICE_TESTS
+
+#include <boost/test/unit_test.hpp>
+#include "test_solver_common.h"
+#include "sokoban_service.h"
+#include <thread>
+#include <string>
+#include <cstdint>
+#include <cstring>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace Sokoban;
+using namespace std;
+
+const char * socket_path = "test_solver_service.sock";
+
+struct Frame {
+    uint8_t type;
+    uint32_t id;
+    string payload;    // after the id
+};
+
+class Client {
+    int _fd;
+
+    static void put_u32(string & data, uint32_t value) {
+        for (int shift = 24; shift >= 0; shift -= 8) { data.push_back(static_cast<char>((value >> shift) & 0xFFu)); }
+    }
+
+    bool read_exact(char * data, size_t size) {
+        while (size > 0u) {
+            const ssize_t count = recv(_fd, data, size, 0);
+            if (count <= 0) { return false; }
+            data += count;
+            size -= static_cast<size_t>(count);
+        }
+        return true;
+    }
+
+    void send_frame(uint8_t type, const string & payload) {
+        string frame;
+        put_u32(frame, static_cast<uint32_t>(payload.size() + 1u));
+        frame.push_back(static_cast<char>(type));
+        frame += payload;
+        BOOST_REQUIRE_EQUAL(::send(_fd, frame.data(), frame.size(), MSG_NOSIGNAL),
+                            static_cast<ssize_t>(frame.size()));
+    }
+
+public:
+    Client() {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        strcpy(address.sun_path, socket_path);
+
+        _fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        BOOST_REQUIRE(connect(_fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) == 0);
+    }
+    ~Client() { ::close(_fd); }
+
+    static uint32_t get_u32(const char * data) {
+        uint32_t value = 0u;
+        for (size_t i = 0; i < 4u; ++i) { value = (value << 8) | static_cast<unsigned char>(data[i]); }
+        return value;
+    }
+
+    void solve(uint32_t id, const string & level, uint32_t time_budget = 0u, uint32_t max_states = 0u) {
+        string payload;
+        put_u32(payload, id);
+        put_u32(payload, time_budget);
+        put_u32(payload, max_states);
+        send_frame(SolverService::SOLVE, payload + level);
+    }
+
+    void cancel(uint32_t id) {
+        string payload;
+        put_u32(payload, id);
+        send_frame(SolverService::CANCEL, payload);
+    }
+
+    Frame read() {
+        char header[4];
+        BOOST_REQUIRE(read_exact(header, sizeof(header)));
+        string frame(get_u32(header), '\0');
+        BOOST_REQUIRE(frame.size() >= 5u);
+        BOOST_REQUIRE(read_exact(frame.data(), frame.size()));
+        return { static_cast<uint8_t>(frame[0]), get_u32(&frame[1]), frame.substr(5) };
+    }
+
+    // skips the progress frames, returns their number
+    Frame read_result(size_t & progress_count) {
+        progress_count = 0u;
+        for (;;) {
+            auto frame = read();
+            if (frame.type == SolverService::RESULT) { return frame; }
+            BOOST_REQUIRE_EQUAL(frame.type, SolverService::PROGRESS);
+            ++progress_count;
+        }
+    }
+};
+
+SolverService::Status status(const Frame & frame) {
+    return static_cast<SolverService::Status>(frame.payload.at(0));
+}
+
+struct ServiceFixture {
+    SolverService service;
+    thread server;
+
+    static ServiceOptions options() {
+        ServiceOptions options;
+        options.progress_interval = chrono::milliseconds{ 0 };
+        return options;
+    }
+
+    ServiceFixture() : service{ socket_path, options() } {
+        BOOST_REQUIRE(service.listen());
+        server = thread([this]{ service.serve(); });
+    }
+    ~ServiceFixture() {
+        service.stop();
+        server.join();
+    }
+};
+
+BOOST_FIXTURE_TEST_CASE(SolveRequests, ServiceFixture)
+{
+    Client client;
+    size_t progress_count = 0u;
+
+    client.solve(1u, "######\n#    #\n#@$ .#\n#    #\n######\n");
+    auto frame = client.read_result(progress_count);
+    BOOST_CHECK_EQUAL(frame.id, 1u);
+    BOOST_REQUIRE(status(frame) == SolverService::Status::Solved);
+    BOOST_CHECK_EQUAL(frame.payload.substr(9), "14:R 15:R\nRR");
+
+    client.solve(2u, "#####\n#@$.\n");
+    frame = client.read_result(progress_count);
+    BOOST_CHECK_EQUAL(frame.id, 2u);
+    BOOST_CHECK(status(frame) == SolverService::Status::Invalid);
+
+    // the same warm worker solves the next levels
+    client.solve(3u, read_level("jr03.sok"));
+    frame = client.read_result(progress_count);
+    BOOST_CHECK_EQUAL(frame.id, 3u);
+    BOOST_CHECK(status(frame) == SolverService::Status::Solved);
+}
+
+BOOST_FIXTURE_TEST_CASE(Limits, ServiceFixture)
+{
+    Client client;
+    size_t progress_count = 0u;
+
+    client.solve(1u, read_level("original_sokoban/01.sok"), 0u, 2000u);
+    auto frame = client.read_result(progress_count);
+    BOOST_CHECK_EQUAL(frame.id, 1u);
+    BOOST_CHECK(status(frame) == SolverService::Status::LimitExceeded);
+    BOOST_CHECK_GT(progress_count, 0u);
+
+    client.solve(2u, read_level("original_sokoban/03.sok"));
+    client.cancel(2u);
+    frame = client.read_result(progress_count);
+    BOOST_CHECK_EQUAL(frame.id, 2u);
+    BOOST_CHECK(status(frame) == SolverService::Status::Cancelled);
+
+    client.solve(3u, read_level("original_sokoban/03.sok"), 1u);
+    frame = client.read_result(progress_count);
+    BOOST_CHECK_EQUAL(frame.id, 3u);
+    BOOST_CHECK(status(frame) == SolverService::Status::Timeout);
+}
+
+BOOST_FIXTURE_TEST_CASE(BudgetFromArrival, ServiceFixture)
+{
+    Client client;
+    size_t progress_count = 0u;
+
+    // the only worker is busy with the first request, the budget of the second
+    // one runs out in the queue
+    client.solve(1u, read_level("original_sokoban/03.sok"), 300u);
+    client.solve(2u, "######\n#    #\n#@$ .#\n#    #\n######\n", 100u);
+
+    auto frame = client.read_result(progress_count);
+    BOOST_CHECK_EQUAL(frame.id, 1u);
+    BOOST_CHECK(status(frame) == SolverService::Status::Timeout);
+
+    frame = client.read_result(progress_count);
+    BOOST_CHECK_EQUAL(frame.id, 2u);
+    BOOST_CHECK(status(frame) == SolverService::Status::Timeout);
+    BOOST_CHECK_EQUAL(progress_count, 0u);
+}
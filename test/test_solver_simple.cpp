@@ -2,8 +2,16 @@
 
 #include <boost/test/unit_test.hpp>
 #include "test_solver_common.h"
+#include "sokoban_solver.h"
+#include "sokoban_move_reconstruction.h"
+#include "sokoban_portfolio.h"
 #include <fstream>
 #include <streambuf>
+#include <sstream>
+#include <algorithm>
+#include <csignal>
+
+#include <sys/resource.h>
 
 using namespace std;
 
@@ -151,3 +159,288 @@ BOOST_AUTO_TEST_CASE(Example03)
     test(indata, {outdata});
 }
 
+BOOST_AUTO_TEST_CASE(ReusedSolver)
+{
+    const string bipartite = read_level("bipartite01.sok");
+    const string example   = read_level("example03.sok");
+    const char * basic = 1 + R"(
+#####
+#@$.#
+#####
+)";
+
+    // the levels of different sizes and box counts, every level twice
+    Sokoban::Solver solver;
+    for (size_t i = 0; i < 2; ++i) {
+        test(solver, example,   {1 + R"(
+29:U 20:R 21:R 22:R 23:R 30:R 31:R 32:R 24:R 25:D
+)"});
+        test(solver, basic,     {1 + R"(
+7:R
+)"});
+        test(solver, bipartite, {1 + R"(
+8:L 15:D 19:D 27:R
+)"});
+    }
+}
+
+BOOST_AUTO_TEST_CASE(AnytimeOptimal)
+{
+    const char * indata = 1 + R"(
+########
+#      #
+# $$ $ #
+#  @   #
+# .. . #
+#      #
+########
+)";
+
+    for (const auto & [level, optimal]: vector<pair<string, size_t>>{
+            { indata, 6u }, { read_level("example03.sok"), 10u }, { read_level("jr03.sok"), 16u } }) {
+        Sokoban::Solver solver;
+        istringstream iss(level);
+        BOOST_REQUIRE(solver.read_level_data(iss));
+
+        vector<size_t> lengths;
+        const bool solved = solver.solve_anytime({}, [&lengths](const auto & pushes, double) {
+            lengths.push_back(pushes.size());
+        });
+
+        BOOST_REQUIRE(solved);
+        BOOST_CHECK(solver.solution_is_optimal());
+        BOOST_CHECK_EQUAL(solver.solution()->size(), optimal);
+        BOOST_REQUIRE(!lengths.empty());
+        BOOST_CHECK_EQUAL(lengths.back(), optimal);
+        for (size_t i = 1; i < lengths.size(); ++i) { BOOST_CHECK_LT(lengths[i], lengths[i - 1]); }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(MoveReconstruction)
+{
+    const char * indata = 1 + R"(
+#######
+#. $  #
+#+$   #
+#######
+)";
+    Sokoban::Solver solver;
+    istringstream iss(indata);
+    BOOST_REQUIRE(solver.read_level_data(iss));
+    BOOST_REQUIRE(solver.solve());
+
+    const auto moves = solver.solution_moves();
+    BOOST_REQUIRE(moves.has_value());
+    BOOST_CHECK_EQUAL(moves.value(), "urRdrruLLLrdL");
+}
+
+BOOST_AUTO_TEST_CASE(MoveReconstructionLong)
+{
+    const char * indata = 1 + R"(
+########
+#      #
+#  $   #
+#@     #
+########
+)";
+    const auto [maze, width, height] = parse_level(indata);
+
+    // the box is pushed back and forth, the player walks around it every time
+    vector<Sokoban::PushInfo> pushes;
+    for (size_t i = 0; i < 20000u; ++i) {
+        if (i % 2 == 0) { pushes.emplace_back(19, 20); }
+        else            { pushes.emplace_back(20, 19); }
+    }
+
+    Sokoban::MoveReconstructor reconstructor(maze, width);
+    const auto moves = reconstructor.moves(pushes);
+    BOOST_REQUIRE(moves.has_value());
+    BOOST_CHECK_EQUAL(count_if(begin(moves.value()), end(moves.value()), ::isupper), 20000);
+    BOOST_CHECK_EQUAL(moves.value().substr(0, 13), "urRurrdLulldR");
+
+    // the push into the wall is impossible
+    pushes.emplace_back(19, 18);
+    pushes.emplace_back(18, 17);
+    pushes.emplace_back(17, 16);
+    BOOST_CHECK(!reconstructor.moves(pushes).has_value());
+}
+
+BOOST_AUTO_TEST_CASE(MoveReconstructionBlockedPlayer)
+{
+    // the tile behind the box is reachable around it, but the player can't stand there
+    const char * indata = 1 + R"(
+########
+#      #
+# #$   #
+#@  $$ #
+########
+)";
+    const auto [maze, width, height] = parse_level(indata);
+
+    Sokoban::MoveReconstructor reconstructor(maze, width);
+    BOOST_CHECK(reconstructor.moves({ { 19, 27 } }).has_value());
+    // the wall behind the box
+    BOOST_CHECK(!reconstructor.moves({ { 19, 20 } }).has_value());
+    // the box behind the box
+    BOOST_CHECK(!reconstructor.moves({ { 28, 27 } }).has_value());
+}
+
+BOOST_AUTO_TEST_CASE(SymmetryPruning)
+{
+    for (const auto & name: { "jr01.sok", "jr06.sok" }) {
+        size_t states[2] = {};
+        for (const bool prune: { false, true }) {
+            Sokoban::Solver solver;
+            solver.set_symmetry_pruning(prune);
+            istringstream iss(read_level(name));
+            BOOST_REQUIRE(solver.read_level_data(iss));
+            BOOST_REQUIRE(solver.solve());
+
+            // the solution is a valid sequence of pushes of the original level
+            BOOST_CHECK(solver.solution_moves().has_value());
+            states[prune] = solver.state_count();
+        }
+        BOOST_CHECK_LT(states[1], states[0]);
+    }
+
+    // an empty level has no player, so there is no area to detect the symmetries of
+    Sokoban::Solver solver;
+    solver.set_symmetry_pruning(true);
+    istringstream empty("");
+    solver.read_level_data(empty);
+}
+
+BOOST_AUTO_TEST_CASE(ExternalSearch)
+{
+    const string directory = "external_search_test";
+    for (const auto & name: { "example03.sok", "jr03.sok", "jr01.sok" }) {
+        Sokoban::Solver greedy;
+        istringstream greedy_iss(read_level(name));
+        BOOST_REQUIRE(greedy.read_level_data(greedy_iss));
+        BOOST_REQUIRE(greedy.solve());
+
+        // the tiny runs force the merges of many sorted files
+        Sokoban::ExternalSearchOptions options;
+        options.directory = directory;
+        options.run_bytes = 4096u;
+        size_t layers = 0u;
+        options.on_layer = [&layers](size_t depth, uint64_t, uint64_t) { layers = depth; };
+
+        Sokoban::Solver solver;
+        istringstream iss(read_level(name));
+        BOOST_REQUIRE(solver.read_level_data(iss));
+        BOOST_REQUIRE(solver.solve_external(options));
+        BOOST_CHECK(solver.solution_is_optimal());
+        BOOST_CHECK(solver.solution_moves().has_value());
+        BOOST_CHECK_LE(solver.solution()->size(), greedy.solution()->size());
+        BOOST_CHECK_EQUAL(layers + 1, solver.solution()->size());
+        BOOST_TEST_MESSAGE(name << ": " << solver.solution()->size() << " pushes");
+    }
+
+    // the layer files are removed
+    ifstream fs(directory + "/sokoban-layer-0.bin");
+    BOOST_CHECK(!fs.is_open());
+}
+
+BOOST_AUTO_TEST_CASE(ExternalSearchIoError)
+{
+    Sokoban::Solver solver;
+    istringstream iss(read_level("jr03.sok"));
+    BOOST_REQUIRE(solver.read_level_data(iss));
+
+    // the directory is a regular file
+    const string file = "external_search_file";
+    ofstream(file) << "x";
+    Sokoban::ExternalSearchOptions options;
+    options.directory = file;
+    BOOST_CHECK(!solver.solve_external(options));
+    BOOST_CHECK(solver.stop_reason() == Sokoban::StopReason::IoError);
+    remove(file.c_str());
+
+    // the full disk: the files are limited to a few records, the writes fail
+    // instead of killing the process
+    rlimit limit{};
+    BOOST_REQUIRE_EQUAL(getrlimit(RLIMIT_FSIZE, &limit), 0);
+    const rlimit small{ 8192u, limit.rlim_max };
+    const auto handler = signal(SIGXFSZ, SIG_IGN);
+    BOOST_REQUIRE_EQUAL(setrlimit(RLIMIT_FSIZE, &small), 0);
+    options.directory = "external_search_test";
+    const bool solved = solver.solve_external(options);
+    setrlimit(RLIMIT_FSIZE, &limit);
+    signal(SIGXFSZ, handler);
+    BOOST_CHECK(!solved);
+    BOOST_CHECK(solver.stop_reason() == Sokoban::StopReason::IoError);
+
+    // the search works again without the limit
+    BOOST_CHECK(solver.solve_external(options));
+    BOOST_CHECK(solver.stop_reason() == Sokoban::StopReason::Solved);
+}
+
+BOOST_AUTO_TEST_CASE(BitstateSearch)
+{
+    const string level = read_level("jr06.sok");
+
+    Sokoban::Solver exact;
+    istringstream exact_iss(level);
+    BOOST_REQUIRE(exact.read_level_data(exact_iss));
+    BOOST_REQUIRE(exact.solve());
+    BOOST_CHECK(!exact.bitstate_stats().has_value());
+
+    // the filter with a negligible omission probability follows the exact search
+    Sokoban::Solver solver;
+    solver.set_bitstate(1u << 20);
+    istringstream iss(level);
+    BOOST_REQUIRE(solver.read_level_data(iss));
+    BOOST_REQUIRE(solver.solve());
+    BOOST_CHECK(solver.solution_moves().has_value());
+    BOOST_CHECK_EQUAL(solver.state_count(), exact.state_count());
+
+    const auto stats = solver.bitstate_stats();
+    BOOST_REQUIRE(stats.has_value());
+    BOOST_CHECK_EQUAL(stats->memory_bytes, 1u << 20);
+    // the graph of the parents and the open list are counted as well
+    BOOST_CHECK_EQUAL(stats->search_memory_bytes, solver.memory_usage());
+    BOOST_CHECK_GT(stats->search_memory_bytes, stats->memory_bytes);
+    // the open list keeps the ids only, a state costs its entry in the graph and a few bytes more
+    BOOST_CHECK_LT(stats->search_memory_bytes - stats->memory_bytes, 16u * solver.state_count());
+    BOOST_CHECK_EQUAL(solver.solution()->size(), exact.solution()->size());
+    BOOST_CHECK_EQUAL(stats->states, solver.state_count());
+    BOOST_CHECK_LT(stats->omission_probability, 1e-6);
+    BOOST_CHECK_LT(stats->expected_omissions, 0.5);
+
+    // a tiny filter omits states, the found solutions are still valid
+    solver.set_bitstate(8u);
+    istringstream tiny_iss(level);
+    BOOST_REQUIRE(solver.read_level_data(tiny_iss));
+    if (solver.solve()) { BOOST_CHECK(solver.solution_moves().has_value()); }
+    BOOST_CHECK_GT(solver.bitstate_stats()->omission_probability, 0.1);
+    BOOST_CHECK_GT(solver.bitstate_stats()->expected_omissions, 0.5);
+}
+
+BOOST_AUTO_TEST_CASE(PortfolioRace)
+{
+    Sokoban::Portfolio portfolio;
+    size_t solved = 0u;
+    for (const auto & name: { "jr01.sok", "jr03.sok", "jr06.sok", "example03.sok", "bipartite01.sok" }) {
+        const auto result = portfolio.solve(read_level(name));
+        BOOST_REQUIRE(result.has_value());
+        BOOST_CHECK(result->moves.has_value());
+        ++solved;
+    }
+
+    // the box in the corner, a greedy search proves the level unsolvable
+    const char * unsolvable = 1 + R"(
+######
+#$  .#
+#@   #
+######
+)";
+    BOOST_CHECK(!portfolio.solve(unsolvable).has_value());
+
+    size_t wins = 0u;
+    for (size_t i = 0; i < Sokoban::STRATEGY_COUNT; ++i) {
+        wins += portfolio.wins(static_cast<Sokoban::PortfolioStrategy>(i));
+    }
+    BOOST_CHECK_EQUAL(wins, solved);
+    BOOST_CHECK_EQUAL(portfolio.level_count(), solved + 1u);
+}
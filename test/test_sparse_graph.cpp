@@ -2,6 +2,9 @@
 
 #include <boost/test/unit_test.hpp>
 #include "sparse_graph.h"
+#include "csr_graph.h"
+#include "graph_traversal.h"
+#include "multi_source_bfs.h"
 #include <string>
 #include <list>
 #include <algorithm>
@@ -10,8 +13,8 @@
 
 using namespace std;
 
-template <typename T, size_t ADJ_MAX, bool Directed>
-string to_string(SparseGraph<T, ADJ_MAX, Directed> & graph) {
+template <typename Graph>
+string to_string(Graph & graph) {
     string result;
 
     for (size_t i = 0; i < graph.size(); ++i) {
@@ -140,3 +143,157 @@ BOOST_AUTO_TEST_CASE(Test01)
     }
 }
 
+
+template <bool Directed>
+void test_csr_removal() {
+    constexpr size_t SIZE = 20;
+    std::uniform_int_distribution<> index_dist(0, SIZE - 1);
+
+    for (size_t i = 0; i < 10; ++i) {
+        list<vpair> ledges;
+        SparseGraph<size_t, SIZE, Directed> graph;
+        graph.resize(SIZE);
+        test_insertion<>(graph, ledges);
+
+        CSRGraph<size_t, SIZE, Directed> csr{ graph };
+        boost_test(to_string(graph), to_string(csr));
+
+        // the copies share the structure, but not the removed edges
+        auto csr_copy = csr;
+        for (size_t j = 0; j < SIZE / 4; ++j) {
+            const size_t node = index_dist(gen);
+            graph.remove_node(node);
+            csr.remove_node(node);
+            boost_test(to_string(graph), to_string(csr));
+        }
+        BOOST_REQUIRE(to_string(csr_copy) != to_string(csr) || ledges.empty());
+
+        csr.transpose();
+        graph.transpose();
+        boost_test(to_string(graph), to_string(csr));
+
+        auto gnodes = graph.nodes();
+        auto cnodes = csr.nodes();
+        vector<size_t> gorder(gnodes.begin(0), gnodes.end());
+        vector<size_t> corder(cnodes.begin(0), cnodes.end());
+        BOOST_REQUIRE(gorder == corder);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(Test02)
+{
+    test_csr_removal<true>();
+    test_csr_removal<false>();
+}
+
+BOOST_AUTO_TEST_CASE(Test03)
+{
+    constexpr size_t SIZE = 20;
+    std::uniform_int_distribution<> index_dist(0, SIZE - 1);
+
+    // the same scratch buffers are reused by all traversals
+    GraphTraversal<size_t> traversal;
+
+    for (size_t i = 0; i < 10; ++i) {
+        list<vpair> ledges;
+        SparseGraph<size_t, SIZE, true> graph;
+        graph.resize(SIZE);
+        test_insertion<>(graph, ledges);
+        const CSRGraph<size_t, SIZE, true> csr{ graph };
+
+        for (size_t j = 0; j < 5; ++j) {
+            const size_t start = index_dist(gen);
+            auto nodes = graph.nodes_with_distances();
+            vector<size_t> expected(nodes.begin(start), nodes.end());
+
+            vector<size_t> observed;
+            traversal.bfs(csr, start, [&observed](size_t ind){ observed.push_back(ind); });
+            BOOST_REQUIRE(observed == expected);
+            BOOST_REQUIRE(vector<size_t>(traversal.begin(), traversal.end()) == expected);
+
+            for (size_t k = 0; k < SIZE; ++k) {
+                const auto dist = nodes.distances()[k];
+                BOOST_REQUIRE(traversal.visited(k) == nodes.visited(k));
+                BOOST_REQUIRE(dist == nodes.MAXDISTANCE
+                           ? traversal.distance(k) == traversal.MAXDISTANCE
+                           : traversal.distance(k) == dist);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(Test04)
+{
+    // more sources than bit lanes in one word
+    constexpr size_t SIZE = 150;
+    std::uniform_int_distribution<> index_dist(0, SIZE - 1);
+    GraphTraversal<size_t> traversal;
+
+    for (size_t i = 0; i < 5; ++i) {
+        SparseGraph<size_t, 4, true> graph;
+        graph.resize(SIZE);
+        for (size_t from = 0; from < SIZE; ++from) {
+            for (size_t j = 0; j < 3; ++j) {
+                const size_t to = index_dist(gen);
+                if (to != from) { graph.insert_edge(from, to); }
+            }
+        }
+        const CSRGraph<size_t, 4, true> csr{ graph };
+
+        vector<size_t> sources;
+        for (size_t j = 0; j < 100; ++j) { sources.push_back(index_dist(gen)); }
+
+        const auto table = multi_source_distances(csr, sources);
+        BOOST_REQUIRE(table.size() == sources.size() * SIZE);
+
+        for (size_t si = 0; si < sources.size(); ++si) {
+            traversal.bfs(csr, sources[si]);
+            for (size_t k = 0; k < SIZE; ++k) {
+                BOOST_REQUIRE_MESSAGE(table[si * SIZE + k] == traversal.distance(k),
+                        "source " << sources[si] << ", node " << k);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(Test05)
+{
+    // reachability with blocked nodes equals the search over the graph without them
+    constexpr size_t SIZE = 60;
+    std::uniform_int_distribution<> index_dist(0, SIZE - 1);
+    GraphTraversal<size_t> traversal;
+    MultiSourceBFS<size_t> bfs;
+
+    for (size_t i = 0; i < 10; ++i) {
+        SparseGraph<size_t, 4, true> graph;
+        graph.resize(SIZE);
+        for (size_t from = 0; from < SIZE; ++from) {
+            for (size_t j = 0; j < 3; ++j) {
+                const size_t to = index_dist(gen);
+                if (to != from) { graph.insert_edge(from, to); }
+            }
+        }
+        const CSRGraph<size_t, 4, true> csr{ graph };
+
+        vector<bool> blocked(SIZE, false);
+        auto removed = csr;
+        for (size_t j = 0; j < SIZE / 5; ++j) {
+            const size_t node = index_dist(gen);
+            blocked[node] = true;
+            removed.remove_node(node);
+        }
+
+        vector<size_t> sources;
+        for (size_t j = 0; j < 20; ++j) { sources.push_back(index_dist(gen)); }
+
+        const auto & reached = bfs.reachability(csr, sources,
+                                                [&blocked](size_t ind){ return blocked[ind]; });
+        for (size_t si = 0; si < sources.size(); ++si) {
+            traversal.bfs(removed, sources[si]);
+            for (size_t k = 0; k < SIZE; ++k) {
+                const bool expected = !blocked[sources[si]] && !blocked[k] && traversal.visited(k);
+                BOOST_REQUIRE(((reached[k] >> si) & 1u) == expected);
+            }
+        }
+    }
+}
@@ -0,0 +1,76 @@
+#define BOOST_TEST_MODULE TASK_GRAPH_TESTS
+
+#include <boost/test/unit_test.hpp>
+#include "task_graph.h"
+#include <vector>
+#include <atomic>
+#include <stdexcept>
+
+using namespace std;
+
+// builds a layered graph: every task of a layer depends on all tasks of the previous one
+void test_layers(ThreadPool & pool) {
+    constexpr size_t LAYERS = 5, WIDTH = 8;
+
+    TaskGraph tasks;
+    atomic<size_t> counter{ 0u };
+    vector<size_t> finished_at(LAYERS * WIDTH, 0u);
+    vector<TaskGraph::task_id> previous;
+
+    for (size_t l = 0; l < LAYERS; ++l) {
+        vector<TaskGraph::task_id> layer;
+        for (size_t w = 0; w < WIDTH; ++w) {
+            layer.push_back(tasks.add("layer" + to_string(l), [&, id=l*WIDTH + w]{
+                finished_at[id] = ++counter;
+            }, previous));
+        }
+        previous = layer;
+    }
+    tasks.run(pool);
+
+    BOOST_REQUIRE(counter == LAYERS * WIDTH);
+    for (size_t l = 1; l < LAYERS; ++l) {
+        for (size_t w = 0; w < WIDTH; ++w) {
+            for (size_t pw = 0; pw < WIDTH; ++pw) {
+                BOOST_REQUIRE(finished_at[(l - 1)*WIDTH + pw] < finished_at[l*WIDTH + w]);
+            }
+        }
+    }
+
+    BOOST_REQUIRE(tasks.timings().size() == LAYERS);
+    for (const auto & st: tasks.timings()) {
+        BOOST_REQUIRE(st.task_count == WIDTH);
+        BOOST_REQUIRE(st.busy_ms >= 0. && st.elapsed_ms >= 0.);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(Test01)
+{
+    ThreadPool current_thread;
+    test_layers(current_thread);
+
+    ThreadPool pool(4);
+    for (size_t i = 0; i < 20; ++i) { test_layers(pool); }
+}
+
+BOOST_AUTO_TEST_CASE(Test02)
+{
+    ThreadPool pool(2);
+    TaskGraph tasks;
+    atomic<bool> dependent_run{ false }, indirect_run{ false }, independent_run{ false };
+
+    const auto failing = tasks.add("fail", []{ throw runtime_error("task error"); });
+    const auto after = tasks.add("after", [&dependent_run]{ dependent_run = true; }, { failing });
+    const auto other = tasks.add("other", [&independent_run]{ independent_run = true; });
+    tasks.add("join", [&indirect_run]{ indirect_run = true; }, { after, other });
+
+    // the dependents of the failed task, directly or not, are skipped; the other tasks run
+    BOOST_REQUIRE_THROW(tasks.run(pool), runtime_error);
+    BOOST_REQUIRE(!dependent_run);
+    BOOST_REQUIRE(!indirect_run);
+    BOOST_REQUIRE(independent_run);
+
+    // the skipped tasks have no timings
+    BOOST_REQUIRE(tasks.timings().size() == 2u);
+    BOOST_REQUIRE(tasks.timings()[0].name == "fail" && tasks.timings()[1].name == "other");
+}
@@ -49,3 +49,23 @@ BOOST_AUTO_TEST_CASE(Test01)
                    "\ncollision_count = " << collision_count);
 }
 
+
+BOOST_AUTO_TEST_CASE(Seeds)
+{
+    constexpr size_t HSIZE = 100;
+
+    // the tables are built at compile time
+    constexpr ZobristHash<HSIZE, ull_t> zhash1(42u);
+    static_assert(zhash1.random_bits(0) != zhash1.random_bits(1));
+    static_assert(zhash1.seed() == 42u);
+
+    const ZobristHash<HSIZE, ull_t> zhash2(42u);
+    const ZobristHash<HSIZE, ull_t> zhash3(43u);
+
+    size_t equal_count = 0u;
+    for (size_t i = 0; i < HSIZE; i++) {
+        BOOST_CHECK_EQUAL(zhash1.random_bits(i), zhash2.random_bits(i));
+        if (zhash1.random_bits(i) == zhash3.random_bits(i)) { equal_count++; }
+    }
+    BOOST_CHECK_EQUAL(equal_count, 0u);
+}